@@ -0,0 +1,219 @@
+#include "cas.hpp"
+#include "urlpath.hpp"
+#include <cstdio>
+#include <fstream>
+#include <openssl/evp.h>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr size_t HASH_HEX_LENGTH = 64;
+// a single body may take at most this share of the cache, so one big file can't flush it
+constexpr size_t MAX_BODY_SHARE = 8;
+
+// paths are percent-escaped in the index so a newline or space in a name can't break its line
+std::string index_line(const std::string &rel, const std::string &hash, uint64_t size, int64_t mtime_ns) {
+    std::string line = fmt::format("{} {} {} ", hash, size, mtime_ns);
+    append_url_escaped(line, rel);
+    line += '\n';
+    return line;
+}
+
+bool stat_file(const fs::path &path, uint64_t &size, int64_t &mtime_ns) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+} // namespace
+
+std::string content_hash(const std::string &data) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(), nullptr);
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string hex(2 * length, '0');
+    for (unsigned int i = 0; i < length; ++i) {
+        hex[2 * i] = HEX[digest[i] >> 4];
+        hex[2 * i + 1] = HEX[digest[i] & 0xf];
+    }
+    return hex;
+}
+
+bool is_content_hash(const std::string &hash) { return hash.size() == HASH_HEX_LENGTH && hash.find_first_not_of("0123456789abcdef") == std::string::npos; }
+
+ContentStore::ContentStore(fs::path root, fs::path index_file, size_t cache_bytes) : root_(std::move(root)), index_file_(std::move(index_file)), cache_bytes_(cache_bytes) { load_index(); }
+
+void ContentStore::load_index() {
+    if (index_file_.empty()) {
+        return;
+    }
+    std::ifstream in(index_file_.string());
+    if (!in) {
+        return;
+    }
+
+    size_t lines = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        Entry entry;
+        std::string escaped;
+        std::string rel;
+        if (!(fields >> entry.hash >> entry.size >> entry.mtime_ns >> escaped) || !is_content_hash(entry.hash)) {
+            continue;
+        }
+        if (!normalize_request_path("/" + escaped, rel) || rel.empty()) {
+            continue;
+        }
+        ++lines;
+        set_entry(rel, entry);
+    }
+    if (logger) {
+        logger->info("Loaded {} content hashes from {}", entries_.size(), index_file_.string());
+    }
+    if (lines == entries_.size()) {
+        return;
+    }
+
+    // later lines superseded earlier ones, rewrite so the log doesn't grow without bound
+    const fs::path tmp = index_file_.string() + ".tmp";
+    {
+        std::ofstream out(tmp.string(), std::ios::trunc);
+        for (const auto &[rel, entry] : entries_) {
+            out << index_line(rel, entry.hash, entry.size, entry.mtime_ns);
+        }
+        if (!out) {
+            return;
+        }
+    }
+    boost::system::error_code ec;
+    fs::rename(tmp, index_file_, ec);
+    if (ec && logger) {
+        logger->warn("Failed to compact content index {}: {}", index_file_.string(), ec.message());
+    }
+}
+
+void ContentStore::append_index(const std::string &rel, const Entry &entry) {
+    if (index_file_.empty()) {
+        return;
+    }
+    // one write per line with O_APPEND, so concurrent appends never interleave
+    const std::string text = index_line(rel, entry.hash, entry.size, entry.mtime_ns);
+    if (FILE *file = std::fopen(index_file_.c_str(), "a")) {
+        std::fwrite(text.data(), 1, text.size(), file);
+        std::fclose(file);
+    } else if (logger) {
+        logger->warn("Failed to append to content index {}", index_file_.string());
+    }
+}
+
+void ContentStore::set_entry(const std::string &rel, const Entry &entry) {
+    const auto old = entries_.find(rel);
+    if (old != entries_.end()) {
+        const auto range = paths_.equal_range(old->second.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == rel) {
+                paths_.erase(it);
+                break;
+            }
+        }
+    }
+    entries_[rel] = entry;
+    paths_.emplace(entry.hash, rel);
+}
+
+std::shared_ptr<const std::string> ContentStore::cache_body(const std::string &hash, std::string &&body) {
+    const auto cached = bodies_.find(hash);
+    if (cached != bodies_.end()) {
+        lru_.splice(lru_.begin(), lru_, cached->second.lru);
+        return cached->second.body;
+    }
+    auto shared = std::make_shared<const std::string>(std::move(body));
+    if (shared->size() > cache_bytes_ / MAX_BODY_SHARE) {
+        return shared;
+    }
+    while (cached_bytes_ + shared->size() > cache_bytes_ && !lru_.empty()) {
+        const auto victim = bodies_.find(lru_.back());
+        cached_bytes_ -= victim->second.body->size();
+        bodies_.erase(victim);
+        lru_.pop_back();
+    }
+    lru_.push_front(hash);
+    bodies_.emplace(hash, CachedBody{shared, lru_.begin()});
+    cached_bytes_ += shared->size();
+    return shared;
+}
+
+std::shared_ptr<const std::string> ContentStore::read(const fs::path &path, const ServerConfig &config, std::string *hash) {
+    const std::string rel = path.lexically_relative(root_).generic_string();
+    Entry current;
+    if (!stat_file(path, current.size, current.mtime_ns)) {
+        return nullptr;
+    }
+    std::string known_hash;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto known = entries_.find(rel);
+        if (known != entries_.end() && known->second.size == current.size && known->second.mtime_ns == current.mtime_ns) {
+            const auto cached = bodies_.find(known->second.hash);
+            if (cached != bodies_.end()) {
+                lru_.splice(lru_.begin(), lru_, cached->second.lru);
+                if (hash) {
+                    *hash = cached->first;
+                }
+                return cached->second.body;
+            }
+            known_hash = known->second.hash;
+        }
+    }
+
+    std::string body = read_file(path.string(), config);
+    if (body.empty() && current.size != 0) {
+        return nullptr;
+    }
+    // a rewrite may keep size and mtime, so a known entry only says which hash to expect; the bytes decide
+    current.hash = content_hash(body);
+    Entry after;
+    if (!stat_file(path, after.size, after.mtime_ns) || after.size != current.size || after.mtime_ns != current.mtime_ns) {
+        // changed while we read it, serve what we got and hash it again next time
+        return std::make_shared<const std::string>(std::move(body));
+    }
+
+    if (hash) {
+        *hash = current.hash;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current.hash != known_hash) {
+        set_entry(rel, current);
+        append_index(rel, current);
+    }
+    return cache_body(current.hash, std::move(body));
+}
+
+fs::path ContentStore::path_for(const std::string &hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto range = paths_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Entry &entry = entries_.at(it->second);
+        const fs::path path = root_ / it->second;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+        if (stat_file(path, size, mtime_ns) && size == entry.size && mtime_ns == entry.mtime_ns) {
+            return path;
+        }
+    }
+    return {};
+}
+
+size_t ContentStore::cached_bytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "utils.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * File bodies keyed by the SHA-256 of their content. Identical files under different paths
+ * share one cached copy, and any known body can be looked up by its hash.
+ *
+ * Hashes are computed lazily, the first time a file is read, and appended to a sidecar index
+ * (`<hash> <size> <mtime_ns> <relative path>` per line) so a restart picks them up again
+ * without rehashing. An entry is trusted for as long as the file's size and mtime match.
+ */
+class ContentStore {
+  public:
+    /**
+     * Loads the sidecar index, compacting it if it holds superseded entries.
+     * @param root Storage root, index paths are relative to it
+     * @param index_file Sidecar index, created on the first hash; empty keeps hashes in memory only
+     * @param cache_bytes Memory budget for cached bodies, 0 disables body caching
+     */
+    ContentStore(fs::path root, fs::path index_file, size_t cache_bytes);
+
+    /**
+     * Reads a file through the cache, hashing it if its content is not known yet.
+     * @param path File below the storage root
+     * @param config Server configuration, for the read limits and hints
+     * @param hash If set, receives the content hash; left empty if the file changed while being read
+     * @return The body, shared with every other path holding the same content; nullptr on error
+     */
+    std::shared_ptr<const std::string> read(const fs::path &path, const ServerConfig &config, std::string *hash = nullptr);
+
+    /**
+     * Finds a file whose current content has the given hash.
+     * @param hash Lowercase hex SHA-256
+     * @return Path of a matching file, empty if the hash is unknown or all its files changed
+     */
+    fs::path path_for(const std::string &hash);
+
+    /**
+     * @return Bytes held by cached bodies
+     */
+    size_t cached_bytes();
+
+  private:
+    struct Entry {
+        std::string hash;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+    };
+
+    struct CachedBody {
+        std::shared_ptr<const std::string> body;
+        std::list<std::string>::iterator lru;
+    };
+
+    void load_index();
+    void append_index(const std::string &rel, const Entry &entry);
+    void set_entry(const std::string &rel, const Entry &entry);
+    std::shared_ptr<const std::string> cache_body(const std::string &hash, std::string &&body);
+
+    const fs::path root_;
+    const fs::path index_file_;
+    const size_t cache_bytes_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;          // relative path -> content
+    std::unordered_multimap<std::string, std::string> paths_; // hash -> relative paths
+    std::unordered_map<std::string, CachedBody> bodies_;      // hash -> body
+    std::list<std::string> lru_;                              // cached hashes, most recent first
+    size_t cached_bytes_ = 0;
+};
+
+/**
+ * Hashes a buffer with SHA-256.
+ * @return Lowercase hex digest
+ */
+std::string content_hash(const std::string &data);
+
+/**
+ * @return True if `hash` looks like a content_hash() digest
+ */
+bool is_content_hash(const std::string &hash);
@@ -0,0 +1,183 @@
+#include "cas.hpp"
+#include <fcntl.h>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+TEST(ContentHashTest, Sha256HexDigest) {
+    EXPECT_EQ(content_hash(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(content_hash("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_TRUE(is_content_hash(content_hash("abc")));
+    EXPECT_FALSE(is_content_hash("BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD"));
+    EXPECT_FALSE(is_content_hash("../etc/passwd"));
+}
+
+class ContentStoreTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / fs::unique_path("tinyfs_cas_test_%%%%%%");
+        fs::create_directories(root / "v1");
+        fs::create_directories(root / "v2");
+        index_file = root.string() + ".idx";
+    }
+
+    void TearDown() override {
+        fs::remove_all(root);
+        fs::remove(index_file);
+    }
+
+    void write(const std::string &rel, const std::string &content) { std::ofstream(root / rel, std::ios::trunc) << content; }
+
+    fs::path root;
+    fs::path index_file;
+    ServerConfig config;
+};
+
+TEST_F(ContentStoreTest, IdenticalFilesShareOneBody) {
+    write("v1/lib.js", "console.log(1)");
+    write("v2/lib.js", "console.log(1)");
+    ContentStore store(root, index_file, 1024 * 1024);
+
+    const auto first = store.read(root / "v1/lib.js", config);
+    const auto second = store.read(root / "v2/lib.js", config);
+    ASSERT_TRUE(first && second);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(store.cached_bytes(), first->size());
+}
+
+TEST_F(ContentStoreTest, ChangedFileIsRehashed) {
+    write("v1/a.txt", "old");
+    ContentStore store(root, index_file, 1024 * 1024);
+    std::string hash;
+    store.read(root / "v1/a.txt", config, &hash);
+    EXPECT_EQ(hash, content_hash("old"));
+
+    write("v1/a.txt", "newer");
+    const auto body = store.read(root / "v1/a.txt", config, &hash);
+    ASSERT_TRUE(body);
+    EXPECT_EQ(*body, "newer");
+    EXPECT_EQ(hash, content_hash("newer"));
+    EXPECT_TRUE(store.path_for(content_hash("old")).empty());
+}
+
+TEST_F(ContentStoreTest, PathForFindsAnyCurrentCopy) {
+    write("v1/a.txt", "same");
+    write("v2/a.txt", "same");
+    ContentStore store(root, index_file, 0);
+    store.read(root / "v1/a.txt", config);
+    store.read(root / "v2/a.txt", config);
+
+    write("v1/a.txt", "edited");
+    EXPECT_EQ(store.path_for(content_hash("same")), root / "v2/a.txt");
+    EXPECT_TRUE(store.path_for(content_hash("unknown")).empty());
+}
+
+TEST_F(ContentStoreTest, HashesSurviveRestart) {
+    write("v1/a.txt", "persisted");
+    {
+        ContentStore store(root, index_file, 0);
+        store.read(root / "v1/a.txt", config);
+    }
+
+    ContentStore restarted(root, index_file, 0);
+    EXPECT_EQ(restarted.path_for(content_hash("persisted")), root / "v1/a.txt");
+}
+
+TEST_F(ContentStoreTest, IndexEscapesAwkwardNames) {
+    write("v1/two\nlines 100%.txt", "awkward");
+    {
+        ContentStore store(root, index_file, 0);
+        store.read(root / "v1/two\nlines 100%.txt", config);
+    }
+
+    ContentStore restarted(root, index_file, 0);
+    EXPECT_EQ(restarted.path_for(content_hash("awkward")), root / "v1/two\nlines 100%.txt");
+}
+
+TEST_F(ContentStoreTest, IndexPathsStayInsideTheRoot) {
+    write("v1/a.txt", "inside");
+    {
+        ContentStore store(root, index_file, 0);
+        store.read(root / "v1/a.txt", config);
+    }
+    // same file, but reached by climbing out of the root and back in
+    std::string line;
+    std::getline(std::ifstream(index_file.string()), line);
+    line.replace(line.rfind(' ') + 1, std::string::npos, "../" + root.filename().string() + "/v1/a.txt");
+    std::ofstream(index_file.string(), std::ios::trunc) << line << '\n';
+
+    ContentStore restarted(root, index_file, 0);
+    EXPECT_TRUE(restarted.path_for(content_hash("inside")).empty());
+}
+
+TEST_F(ContentStoreTest, IndexIsCompactedOnLoad) {
+    write("v1/a.txt", "one");
+    {
+        ContentStore store(root, index_file, 0);
+        store.read(root / "v1/a.txt", config);
+        write("v1/a.txt", "two!");
+        store.read(root / "v1/a.txt", config);
+    }
+    ContentStore restarted(root, index_file, 0);
+
+    std::ifstream in(index_file.string());
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(in, line)) {
+        ++lines;
+    }
+    EXPECT_EQ(lines, 1u);
+    EXPECT_EQ(restarted.path_for(content_hash("two!")), root / "v1/a.txt");
+}
+
+TEST_F(ContentStoreTest, EvictsLeastRecentlyUsedWithinBudget) {
+    // 45-byte bodies against a 400-byte budget: eight fit
+    std::vector<std::shared_ptr<const std::string>> bodies;
+    for (int i = 0; i < 9; ++i) {
+        write("v1/" + std::to_string(i), std::string(44, 'x') + std::to_string(i));
+    }
+    ContentStore store(root, index_file, 400);
+    for (int i = 0; i < 8; ++i) {
+        bodies.push_back(store.read(root / "v1" / std::to_string(i), config));
+    }
+    store.read(root / "v1/0", config);
+    store.read(root / "v1/8", config);
+
+    // 1 was least recently used and had to go, 0 is still the cached copy
+    EXPECT_EQ(store.cached_bytes(), 8u * 45);
+    EXPECT_EQ(store.read(root / "v1/0", config).get(), bodies[0].get());
+    EXPECT_NE(store.read(root / "v1/1", config).get(), bodies[1].get());
+}
+
+TEST_F(ContentStoreTest, RewriteOfEvictedBodyIsRehashed) {
+    write("v1/a.txt", std::string(44, 'a'));
+    ContentStore store(root, index_file, 400);
+    std::string hash;
+    store.read(root / "v1/a.txt", config, &hash);
+    EXPECT_EQ(hash, content_hash(std::string(44, 'a')));
+    struct stat before {};
+    ASSERT_EQ(::stat((root / "v1/a.txt").c_str(), &before), 0);
+
+    // push the body out of the cache, then rewrite the file keeping its size and mtime
+    for (int i = 0; i < 8; ++i) {
+        write("v2/" + std::to_string(i), std::string(44, 'x') + std::to_string(i));
+        store.read(root / "v2" / std::to_string(i), config);
+    }
+    write("v1/a.txt", std::string(44, 'z'));
+    const timespec times[2] = {before.st_atim, before.st_mtim};
+    ASSERT_EQ(::utimensat(AT_FDCWD, (root / "v1/a.txt").c_str(), times, 0), 0);
+
+    const auto body = store.read(root / "v1/a.txt", config, &hash);
+    ASSERT_TRUE(body);
+    EXPECT_EQ(*body, std::string(44, 'z'));
+    EXPECT_EQ(hash, content_hash(std::string(44, 'z')));
+    EXPECT_TRUE(store.path_for(content_hash(std::string(44, 'a'))).empty());
+}
+
+TEST_F(ContentStoreTest, LargeBodiesBypassTheCache) {
+    write("v1/big", std::string(100, 'x'));
+    ContentStore store(root, index_file, 400);
+
+    ASSERT_TRUE(store.read(root / "v1/big", config));
+    EXPECT_EQ(store.cached_bytes(), 0u);
+}
@@ -0,0 +1,195 @@
+#include "handover.hpp"
+#include "utils.hpp"
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+bool send_fds(int sock, const std::vector<int> &fds, const std::string &tag) {
+    if (fds.empty() || tag.size() != fds.size()) {
+        return false;
+    }
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+    iovec iov{const_cast<char *>(tag.data()), tag.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    ssize_t sent;
+    do {
+        sent = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    return sent == static_cast<ssize_t>(tag.size());
+}
+
+std::vector<int> receive_fds(int sock, size_t max_fds, std::string &tag) {
+    std::vector<char> payload(max_fds);
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * max_fds));
+    iovec iov{payload.data(), payload.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t received;
+    do {
+        received = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0) {
+        return {};
+    }
+
+    std::vector<int> fds;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const size_t offset = fds.size();
+            fds.resize(offset + count);
+            std::memcpy(fds.data() + offset, CMSG_DATA(cmsg), sizeof(int) * count);
+        }
+    }
+    // a truncated message means we can't tell which descriptor is which
+    if ((msg.msg_flags & (MSG_CTRUNC | MSG_TRUNC)) != 0 || fds.size() != static_cast<size_t>(received)) {
+        for (const int fd : fds) {
+            ::close(fd);
+        }
+        return {};
+    }
+    tag.assign(payload.data(), static_cast<size_t>(received));
+    return fds;
+}
+
+Takeover request_takeover(const std::string &path, std::chrono::milliseconds timeout) {
+    Takeover takeover;
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return takeover;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    const int conn = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conn < 0) {
+        return takeover;
+    }
+    // a wedged old process must not keep us from starting, binding fresh listeners is the fallback
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+    ::setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (::connect(conn, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        // nobody to take over from, a plain cold start
+        ::close(conn);
+        return takeover;
+    }
+
+    takeover.fds = receive_fds(conn, 8, takeover.tag);
+    if (takeover.fds.empty()) {
+        if (logger) {
+            logger->warn("Handover from {} failed, binding fresh listeners", path);
+        }
+        ::close(conn);
+        return takeover;
+    }
+    takeover.conn = conn;
+    if (logger) {
+        logger->info("Inherited {} listening socket(s) from the running server on {}", takeover.fds.size(), path);
+    }
+    return takeover;
+}
+
+void finish_takeover(Takeover &takeover) {
+    if (takeover.conn < 0) {
+        return;
+    }
+    const char ack = 'k';
+    if (::send(takeover.conn, &ack, 1, MSG_NOSIGNAL) != 1 && logger) {
+        logger->warn("Failed to confirm handover: {}", std::strerror(errno));
+    }
+    ::close(takeover.conn);
+    takeover.conn = -1;
+}
+
+std::shared_ptr<tcp::acceptor> adopt_listener(const net::any_io_executor &executor, int fd) {
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+        ::close(fd);
+        throw std::runtime_error(std::string("Inherited listener is not a socket: ") + std::strerror(errno));
+    }
+    auto acceptor = std::make_shared<tcp::acceptor>(executor);
+    acceptor->assign(addr.ss_family == AF_INET6 ? tcp::v6() : tcp::v4(), fd);
+    return acceptor;
+}
+
+HandoverServer::HandoverServer(const net::any_io_executor &executor, std::string path, std::vector<int> fds, std::string tag, std::function<void()> on_handover) : path_(std::move(path)), fds_(std::move(fds)), tag_(std::move(tag)), on_handover_(std::move(on_handover)), acceptor_(executor) {
+    // a predecessor we just took over from, or a stale file from a crash, keeps its inode but loses the name
+    ::unlink(path_.c_str());
+    const net::local::stream_protocol::endpoint endpoint(path_);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    if (logger) {
+        logger->info("Accepting listener handover requests on {}", path_);
+    }
+    do_accept();
+}
+
+void HandoverServer::do_accept() {
+    auto socket = std::make_shared<net::local::stream_protocol::socket>(acceptor_.get_executor());
+    acceptor_.async_accept(*socket, [this, socket](boost::system::error_code ec) {
+        if (ec) {
+            if (ec != net::error::operation_aborted && logger) {
+                logger->error("Handover accept error: {}", ec.message());
+            }
+            return;
+        }
+        if (!send_fds(socket->native_handle(), fds_, tag_)) {
+            if (logger) {
+                logger->error("Failed to pass listening sockets: {}", std::strerror(errno));
+            }
+            do_accept();
+            return;
+        }
+
+        // the successor acknowledges once it is accepting, or hangs up if it failed to start
+        auto ack = std::make_shared<char>(0);
+        net::async_read(*socket, net::buffer(ack.get(), 1), [this, socket, ack](boost::system::error_code read_ec, size_t) {
+            if (read_ec) {
+                if (logger) {
+                    logger->warn("Successor did not confirm the handover, continuing to serve");
+                }
+                do_accept();
+                return;
+            }
+            if (logger) {
+                logger->info("Listening sockets handed over to successor");
+            }
+            handed_over_ = true;
+            on_handover_();
+        });
+    });
+}
+
+void HandoverServer::close() {
+    boost::system::error_code ec;
+    acceptor_.close(ec);
+    if (!handed_over_) {
+        ::unlink(path_.c_str());
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+/**
+ * Sends file descriptors over a connected Unix socket (SCM_RIGHTS).
+ * @param sock Connected Unix stream socket
+ * @param fds Descriptors to pass, they stay open in the sender
+ * @param tag Payload sent alongside, one byte per descriptor describing it
+ * @return True on success
+ */
+bool send_fds(int sock, const std::vector<int> &fds, const std::string &tag);
+
+/**
+ * Receives descriptors sent by send_fds().
+ * @param sock Connected Unix stream socket
+ * @param max_fds Upper bound on descriptors accepted
+ * @param tag Receives the payload sent alongside
+ * @return The received descriptors, owned by the caller; empty on error
+ */
+std::vector<int> receive_fds(int sock, size_t max_fds, std::string &tag);
+
+/**
+ * Listening sockets inherited from a running server, see request_takeover().
+ */
+struct Takeover {
+    int conn = -1;        // Connection to the old process, open until finish_takeover()
+    std::vector<int> fds; // Listening sockets, owned by the caller
+    std::string tag;      // One byte per descriptor: 'p' plain HTTP, 't' HTTPS
+};
+
+/**
+ * New process side: asks the server listening on `path` for its listening sockets.
+ * @param path Handover Unix socket path
+ * @param timeout How long a stuck server may take to connect and answer
+ * @return The inherited sockets, or an empty Takeover if no server answers on `path` in time
+ */
+Takeover request_takeover(const std::string &path, std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+/**
+ * Tells the old process that the inherited sockets are being accepted on, so it stops
+ * accepting and drains. Closes the handover connection.
+ */
+void finish_takeover(Takeover &takeover);
+
+/**
+ * Wraps an inherited listening socket in an acceptor, picking IPv4 or IPv6 from the socket itself.
+ * @param executor Executor the acceptor runs its handlers on
+ * @param fd Listening socket, ownership passes to the acceptor
+ */
+std::shared_ptr<tcp::acceptor> adopt_listener(const net::any_io_executor &executor, int fd);
+
+/**
+ * Old process side: serves takeover requests on a Unix socket. After a new process has
+ * confirmed the takeover, `on_handover` runs on the given executor.
+ */
+class HandoverServer {
+  public:
+    /**
+     * Binds `path`, replacing a stale socket file left by a previous process.
+     * @param executor Executor `on_handover` and the accept handlers run on
+     * @param fds Listening sockets to hand out
+     * @param tag One byte per descriptor, see Takeover::tag
+     * @throws boost::system::system_error if `path` cannot be bound
+     */
+    HandoverServer(const net::any_io_executor &executor, std::string path, std::vector<int> fds, std::string tag, std::function<void()> on_handover);
+
+    /**
+     * Stops serving requests. The socket file is left alone once a successor owns it.
+     */
+    void close();
+
+  private:
+    void do_accept();
+
+    std::string path_;
+    std::vector<int> fds_;
+    std::string tag_;
+    std::function<void()> on_handover_;
+    net::local::stream_protocol::acceptor acceptor_;
+    bool handed_over_ = false;
+};
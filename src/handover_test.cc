@@ -0,0 +1,103 @@
+#include "handover.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+class PassFdsTest : public ::testing::Test {
+  protected:
+    void SetUp() override { ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0); }
+    void TearDown() override {
+        ::close(pair[0]);
+        ::close(pair[1]);
+    }
+
+    int pair[2] = {-1, -1};
+};
+
+TEST_F(PassFdsTest, ReceivedDescriptorsReferToTheSameFiles) {
+    int pipe_fds[2];
+    ASSERT_EQ(::pipe(pipe_fds), 0);
+    ASSERT_TRUE(send_fds(pair[0], {pipe_fds[0], pipe_fds[1]}, "rw"));
+
+    std::string tag;
+    const auto fds = receive_fds(pair[1], 8, tag);
+    ASSERT_EQ(fds.size(), 2u);
+    EXPECT_EQ(tag, "rw");
+    EXPECT_NE(fds[0], pipe_fds[0]);
+
+    // write through the received write end, read through the original read end
+    ASSERT_EQ(::write(fds[1], "x", 1), 1);
+    char c = 0;
+    ASSERT_EQ(::read(pipe_fds[0], &c, 1), 1);
+    EXPECT_EQ(c, 'x');
+
+    for (const int fd : {pipe_fds[0], pipe_fds[1], fds[0], fds[1]}) {
+        ::close(fd);
+    }
+}
+
+TEST_F(PassFdsTest, RejectsMismatchedTag) { EXPECT_FALSE(send_fds(pair[0], {0}, "pt")); }
+
+TEST_F(PassFdsTest, TooManyDescriptorsAreDropped) {
+    ASSERT_TRUE(send_fds(pair[0], {0, 1, 2}, "ppp"));
+
+    std::string tag;
+    EXPECT_TRUE(receive_fds(pair[1], 2, tag).empty());
+}
+
+TEST(TakeoverTest, NoServerMeansColdStart) {
+    const Takeover takeover = request_takeover("/tmp/tinyfs-handover-test-nobody.sock");
+
+    EXPECT_EQ(takeover.conn, -1);
+    EXPECT_TRUE(takeover.fds.empty());
+}
+
+TEST(TakeoverTest, UnresponsiveServerTimesOut) {
+    const std::string path = "/tmp/tinyfs-handover-test-stuck-" + std::to_string(::getpid()) + ".sock";
+    net::io_context ioc;
+    // listens but never answers, like a wedged old process
+    net::local::stream_protocol::acceptor stuck(ioc, net::local::stream_protocol::endpoint(path));
+
+    const auto start = std::chrono::steady_clock::now();
+    const Takeover takeover = request_takeover(path, std::chrono::milliseconds(200));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+    EXPECT_EQ(takeover.conn, -1);
+    EXPECT_TRUE(takeover.fds.empty());
+
+    stuck.close();
+    ::unlink(path.c_str());
+}
+
+TEST(TakeoverTest, SuccessorInheritsListenerAndOldServerIsNotified) {
+    const std::string path = "/tmp/tinyfs-handover-test-" + std::to_string(::getpid()) + ".sock";
+    net::io_context ioc;
+    tcp::acceptor listener(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0});
+    bool handed_over = false;
+    HandoverServer server(ioc.get_executor(), path, {listener.native_handle()}, "p", [&]() { handed_over = true; });
+    std::thread old_process([&]() { ioc.run_for(std::chrono::seconds(5)); });
+
+    Takeover takeover = request_takeover(path);
+    ASSERT_EQ(takeover.fds.size(), 1u);
+    EXPECT_EQ(takeover.tag, "p");
+
+    net::io_context successor_ioc;
+    auto inherited = adopt_listener(successor_ioc.get_executor(), takeover.fds[0]);
+    EXPECT_EQ(inherited->local_endpoint(), listener.local_endpoint());
+
+    finish_takeover(takeover);
+    old_process.join();
+    EXPECT_TRUE(handed_over);
+
+    // the old process may close its copy, the successor's listener keeps accepting
+    listener.close();
+    tcp::socket client(successor_ioc);
+    client.connect(inherited->local_endpoint());
+    tcp::socket accepted(successor_ioc);
+    inherited->accept(accepted);
+    EXPECT_TRUE(accepted.is_open());
+
+    server.close();
+    ::unlink(path.c_str());
+}
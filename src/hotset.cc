@@ -0,0 +1,269 @@
+#include "hotset.hpp"
+#include "prefetch.hpp"
+#include "urlpath.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// v2 percent-escapes the paths, v1 wrote them raw and a newline in a name split its line
+constexpr char PROFILE_HEADER[] = "# tinyfs hot set v2";
+constexpr auto PROGRESS_INTERVAL = std::chrono::seconds(2);
+
+double to_mib(size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+// second, independent hash for the sketch rows (FNV-1a), the first one is std::hash
+uint64_t fnv1a(const std::string &s) {
+    uint64_t h = 14695981039346656037ull;
+    for (const char c : s) {
+        h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return h;
+}
+
+} // namespace
+
+HotSet::HotSet(fs::path root, fs::path file) : root_(std::move(root)), file_(std::move(file)), sketch_(std::make_unique<std::array<std::atomic<uint32_t>, DEPTH * WIDTH>>()) {
+    for (auto &counter : *sketch_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+HotSet::~HotSet() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    if (warmup_worker_.joinable()) {
+        warmup_worker_.join();
+    }
+    if (persist_worker_.joinable()) {
+        persist_worker_.join();
+        save();
+    }
+}
+
+uint64_t HotSet::add(const std::string &rel_path, uint64_t count) {
+    // row i probes h1 + i * h2, the usual double-hashing trick
+    const uint64_t h1 = std::hash<std::string>{}(rel_path);
+    const uint64_t h2 = fnv1a(rel_path) | 1;
+    const auto increment = static_cast<uint32_t>(std::min<uint64_t>(count, UINT32_MAX));
+    uint64_t estimate = UINT64_MAX;
+    for (size_t row = 0; row < DEPTH; ++row) {
+        auto &counter = (*sketch_)[row * WIDTH + (h1 + row * h2) % WIDTH];
+        estimate = std::min<uint64_t>(estimate, counter.fetch_add(increment, std::memory_order_relaxed) + increment);
+    }
+    return estimate;
+}
+
+uint64_t HotSet::estimate(const std::string &rel_path) const {
+    const uint64_t h1 = std::hash<std::string>{}(rel_path);
+    const uint64_t h2 = fnv1a(rel_path) | 1;
+    uint64_t estimate = UINT64_MAX;
+    for (size_t row = 0; row < DEPTH; ++row) {
+        estimate = std::min<uint64_t>(estimate, (*sketch_)[row * WIDTH + (h1 + row * h2) % WIDTH].load(std::memory_order_relaxed));
+    }
+    return estimate;
+}
+
+void HotSet::track(const std::string &rel_path, uint64_t estimate) {
+    // most accesses are to paths far below the top-K floor and never take the lock
+    if (estimate <= top_floor_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(top_mutex_);
+    top_[rel_path] = std::max(top_[rel_path], estimate);
+    if (top_.size() <= TOP_K) {
+        return;
+    }
+    auto coldest = std::min_element(top_.begin(), top_.end(), [](const auto &a, const auto &b) { return a.second < b.second; });
+    top_.erase(coldest);
+    coldest = std::min_element(top_.begin(), top_.end(), [](const auto &a, const auto &b) { return a.second < b.second; });
+    top_floor_.store(coldest->second, std::memory_order_relaxed);
+}
+
+void HotSet::record(const std::string &rel_path) { track(rel_path, add(rel_path, 1)); }
+
+std::vector<HotSet::Entry> HotSet::hottest() const {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(top_mutex_);
+        entries.reserve(top_.size());
+        for (const auto &[path, count] : top_) {
+            entries.push_back({path, count});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.count != b.count ? a.count > b.count : a.path < b.path; });
+    return entries;
+}
+
+void HotSet::decay() {
+    // increments racing with this may be lost, which a frequency estimate can live with
+    for (auto &counter : *sketch_) {
+        counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(top_mutex_);
+    for (auto it = top_.begin(); it != top_.end();) {
+        it->second /= 2;
+        it = it->second == 0 ? top_.erase(it) : std::next(it);
+    }
+    top_floor_.store(top_floor_.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+}
+
+bool HotSet::save() const {
+    const auto entries = hottest();
+    const fs::path tmp = file_.string() + ".tmp";
+    {
+        std::ofstream out(tmp.string(), std::ios::trunc);
+        out << PROFILE_HEADER << '\n';
+        for (const auto &entry : entries) {
+            std::string escaped;
+            append_url_escaped(escaped, entry.path);
+            out << entry.count << ' ' << escaped << '\n';
+        }
+        if (!out) {
+            if (logger) {
+                logger->warn("Failed to write hot set profile {}", tmp.string());
+            }
+            return false;
+        }
+    }
+    boost::system::error_code ec;
+    fs::rename(tmp, file_, ec);
+    if (ec) {
+        if (logger) {
+            logger->warn("Failed to replace hot set profile {}: {}", file_.string(), ec.message());
+        }
+        return false;
+    }
+    return true;
+}
+
+size_t HotSet::load() {
+    std::ifstream in(file_.string());
+    std::string line;
+    if (!in || !std::getline(in, line) || line != PROFILE_HEADER) {
+        return 0;
+    }
+    size_t loaded = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        uint64_t count = 0;
+        std::string escaped;
+        std::string path;
+        if (!(fields >> count >> escaped) || count == 0) {
+            continue;
+        }
+        // the profile is only a file on disk, a path in it must not reach outside the root
+        if (!normalize_request_path("/" + escaped, path) || path.empty()) {
+            continue;
+        }
+        track(path, add(path, count));
+        ++loaded;
+    }
+    return loaded;
+}
+
+void HotSet::start(std::chrono::seconds persist_interval, size_t warmup_budget, std::function<void(const fs::path &)> load_body) {
+    auto entries = hottest();
+    if (warmup_budget > 0 && !entries.empty()) {
+        warmup_running_ = true;
+        warmup_planned_ = entries.size();
+        warmup_budget_ = warmup_budget;
+        warmup_worker_ = std::thread([this, entries = std::move(entries), warmup_budget, load_body = std::move(load_body)]() mutable { warm_up(std::move(entries), warmup_budget, load_body); });
+    }
+    persist_worker_ = std::thread([this, persist_interval]() { persist_loop(persist_interval); });
+}
+
+void HotSet::warm_up(std::vector<Entry> entries, size_t budget, const std::function<void(const fs::path &)> &load_body) {
+    const auto start = std::chrono::steady_clock::now();
+    auto last_progress = start;
+    if (logger) {
+        logger->info("Warming up {} hot paths within {:.1f} MiB", entries.size(), to_mib(budget));
+    }
+
+    size_t used = 0;
+    for (const auto &entry : entries) {
+        {
+            std::lock_guard<std::mutex> lock(stop_mutex_);
+            if (stopping_) {
+                break;
+            }
+        }
+        const fs::path path = root_ / entry.path;
+        boost::system::error_code ec;
+        const auto size = fs::file_size(path, ec);
+        // gone, or too big for what is left: a colder but smaller file may still fit
+        if (ec || size > budget - used) {
+            continue;
+        }
+        // a warmed file is hot by definition, its first request must not drop it again
+        mark_read_before(path.string());
+        prefetch_file(path);
+        if (load_body) {
+            load_body(path);
+        }
+        used += size;
+        ++warmup_files_;
+        warmup_bytes_ = used;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_progress >= PROGRESS_INTERVAL && logger) {
+            logger->info("Warmup: {} of {} paths, {:.1f} MiB", warmup_files_.load(), entries.size(), to_mib(used));
+            last_progress = now;
+        }
+    }
+
+    warmup_running_ = false;
+    if (logger) {
+        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        logger->info("Warmup done: {} of {} paths, {:.1f} of {:.1f} MiB in {} ms", warmup_files_.load(), entries.size(), to_mib(used), to_mib(budget), elapsed_ms);
+    }
+}
+
+void HotSet::persist_loop(std::chrono::seconds interval) {
+    auto last_decay = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_cv_.wait_for(lock, interval, [this]() { return stopping_; })) {
+        lock.unlock();
+        save();
+        if (std::chrono::steady_clock::now() - last_decay >= DECAY_PERIOD) {
+            decay();
+            last_decay = std::chrono::steady_clock::now();
+        }
+        lock.lock();
+    }
+}
+
+HotSet::WarmupStatus HotSet::warmup_status() const {
+    WarmupStatus status;
+    status.running = warmup_running_;
+    status.planned = warmup_planned_;
+    status.files = warmup_files_;
+    status.bytes = warmup_bytes_;
+    status.budget = warmup_budget_;
+    return status;
+}
+
+std::string warmup_response_json(const HotSet &hot_set, size_t limit) {
+    const auto status = hot_set.warmup_status();
+    std::string json = R"({"running":)" + std::string(status.running ? "true" : "false");
+    json += R"(,"planned":)" + std::to_string(status.planned);
+    json += R"(,"files":)" + std::to_string(status.files);
+    json += R"(,"bytes":)" + std::to_string(status.bytes);
+    json += R"(,"budget":)" + std::to_string(status.budget);
+    json += R"(,"hottest":[)";
+    const auto entries = hot_set.hottest();
+    for (size_t i = 0; i < entries.size() && i < limit; ++i) {
+        if (i != 0) {
+            json += ',';
+        }
+        json += R"({"path":)";
+        append_json_string(json, entries[i].path);
+        json += R"(,"count":)" + std::to_string(entries[i].count) + "}";
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "utils.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Tracks which paths are requested most, so a restarted server can warm its caches with them.
+ *
+ * Frequencies live in a count-min sketch, fixed size no matter how many distinct paths are
+ * seen, next to a top-K list of the heaviest paths. Counts are halved every DECAY_PERIOD so
+ * the profile follows changing traffic. The top-K list is persisted periodically and on
+ * shutdown. On startup it seeds the sketch and drives the warmup: the hottest paths are
+ * read ahead into the page cache and handed to a loader, within a byte budget, on a
+ * background thread while the server is already accepting.
+ */
+class HotSet {
+  public:
+    struct Entry {
+        std::string path; // Relative to the storage root
+        uint64_t count = 0;
+    };
+
+    struct WarmupStatus {
+        bool running = false; // The warmup thread is still going
+        size_t planned = 0;   // Paths in the loaded profile
+        size_t files = 0;     // Paths warmed so far
+        size_t bytes = 0;     // Bytes warmed so far
+        size_t budget = 0;    // Byte budget for the whole warmup
+    };
+
+    static constexpr size_t TOP_K = 1024;
+    static constexpr std::chrono::minutes DECAY_PERIOD{30};
+
+    /**
+     * @param root Storage root, profile paths are relative to it
+     * @param file Where the profile is persisted
+     */
+    HotSet(fs::path root, fs::path file);
+    ~HotSet();
+
+    HotSet(const HotSet &) = delete;
+    HotSet &operator=(const HotSet &) = delete;
+    HotSet(HotSet &&) = delete;
+    HotSet &operator=(HotSet &&) = delete;
+
+    /**
+     * Counts one access. Lock-free unless the path is heavy enough for the top-K list.
+     * @param rel_path Path relative to the storage root
+     */
+    void record(const std::string &rel_path);
+
+    /**
+     * @return Estimated accesses of `rel_path`, never lower than the true (decayed) count
+     */
+    uint64_t estimate(const std::string &rel_path) const;
+
+    /**
+     * @return Up to TOP_K heaviest paths, hottest first
+     */
+    std::vector<Entry> hottest() const;
+
+    /**
+     * Halves every count, forgetting paths that drop to zero.
+     */
+    void decay();
+
+    /**
+     * Writes the top-K list to the profile file, replacing it atomically.
+     * @return True on success
+     */
+    bool save() const;
+
+    /**
+     * Seeds the counts from the profile file, if there is one. Paths that escape the root are skipped.
+     * @return Number of paths loaded
+     */
+    size_t load();
+
+    /**
+     * Starts the background threads: warmup from the loaded profile, and periodic persisting.
+     * @param persist_interval How often the profile is written
+     * @param warmup_budget Bytes to warm at most, 0 skips the warmup
+     * @param load_body Called on each warmed path after readahead, e.g. to fill an in-process cache; may be empty
+     */
+    void start(std::chrono::seconds persist_interval, size_t warmup_budget, std::function<void(const fs::path &)> load_body);
+
+    WarmupStatus warmup_status() const;
+
+  private:
+    static constexpr size_t DEPTH = 4;
+    static constexpr size_t WIDTH = 1 << 14;
+
+    uint64_t add(const std::string &rel_path, uint64_t count);
+    void track(const std::string &rel_path, uint64_t estimate);
+    void warm_up(std::vector<Entry> entries, size_t budget, const std::function<void(const fs::path &)> &load_body);
+    void persist_loop(std::chrono::seconds interval);
+
+    const fs::path root_;
+    const fs::path file_;
+
+    std::unique_ptr<std::array<std::atomic<uint32_t>, DEPTH * WIDTH>> sketch_;
+    mutable std::mutex top_mutex_;
+    std::unordered_map<std::string, uint64_t> top_;
+    std::atomic<uint64_t> top_floor_{0}; // Smallest count in a full top-K list
+
+    std::atomic<bool> warmup_running_{false};
+    std::atomic<size_t> warmup_planned_{0};
+    std::atomic<size_t> warmup_files_{0};
+    std::atomic<size_t> warmup_bytes_{0};
+    std::atomic<size_t> warmup_budget_{0};
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+    std::thread warmup_worker_;
+    std::thread persist_worker_;
+};
+
+/**
+ * Answers `GET /__warmup` with the warmup progress and the current hottest paths.
+ * @param hot_set The hot set
+ * @param limit Number of hottest paths listed
+ * @return JSON document
+ */
+std::string warmup_response_json(const HotSet &hot_set, size_t limit);
@@ -0,0 +1,174 @@
+#include "hotset.hpp"
+#include <fstream>
+#include <gtest/gtest.h>
+#include <thread>
+
+class HotSetTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / fs::unique_path("tinyfs_hotset_test_%%%%%%");
+        fs::create_directories(root / "assets");
+        profile = root / ".tinyfs-hotset";
+    }
+
+    void TearDown() override { fs::remove_all(root); }
+
+    void write(const std::string &rel, size_t size) { std::ofstream(root / rel) << std::string(size, 'x'); }
+
+    void record(HotSet &hot_set, const std::string &rel, int times) {
+        for (int i = 0; i < times; ++i) {
+            hot_set.record(rel);
+        }
+    }
+
+    // waits for the warmup thread to finish
+    void wait_for_warmup(const HotSet &hot_set) {
+        for (int i = 0; i < 200 && hot_set.warmup_status().running; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    fs::path root;
+    fs::path profile;
+};
+
+TEST_F(HotSetTest, HottestFirst) {
+    HotSet hot_set(root, profile);
+    record(hot_set, "a.html", 5);
+    record(hot_set, "assets/b.js", 20);
+    record(hot_set, "c.css", 1);
+
+    const auto entries = hot_set.hottest();
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0].path, "assets/b.js");
+    EXPECT_EQ(entries[1].path, "a.html");
+    EXPECT_EQ(entries[2].path, "c.css");
+}
+
+TEST_F(HotSetTest, EstimatesNeverUndercount) {
+    HotSet hot_set(root, profile);
+    for (int i = 0; i < 20000; ++i) {
+        hot_set.record("file" + std::to_string(i % 5000));
+    }
+    record(hot_set, "hot", 100);
+
+    EXPECT_GE(hot_set.estimate("hot"), 100u);
+    for (int i = 0; i < 5000; i += 97) {
+        EXPECT_GE(hot_set.estimate("file" + std::to_string(i)), 4u);
+    }
+}
+
+TEST_F(HotSetTest, TopListIsBoundedAndKeepsHeavyPaths) {
+    HotSet hot_set(root, profile);
+    record(hot_set, "heavy", 50);
+    for (size_t i = 0; i < 3 * HotSet::TOP_K; ++i) {
+        hot_set.record("tail" + std::to_string(i));
+    }
+
+    const auto entries = hot_set.hottest();
+    EXPECT_LE(entries.size(), HotSet::TOP_K);
+    EXPECT_EQ(entries.front().path, "heavy");
+}
+
+TEST_F(HotSetTest, DecayHalvesAndForgets) {
+    HotSet hot_set(root, profile);
+    record(hot_set, "a", 8);
+    record(hot_set, "b", 1);
+    hot_set.decay();
+
+    EXPECT_EQ(hot_set.estimate("a"), 4u);
+    const auto entries = hot_set.hottest();
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].path, "a");
+}
+
+TEST_F(HotSetTest, ProfileSurvivesRestart) {
+    {
+        HotSet hot_set(root, profile);
+        record(hot_set, "a.html", 3);
+        record(hot_set, "name with spaces.txt", 7);
+        ASSERT_TRUE(hot_set.save());
+    }
+
+    HotSet restarted(root, profile);
+    EXPECT_EQ(restarted.load(), 2u);
+    const auto entries = restarted.hottest();
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].path, "name with spaces.txt");
+    EXPECT_EQ(entries[0].count, 7u);
+    EXPECT_GE(restarted.estimate("a.html"), 3u);
+}
+
+TEST_F(HotSetTest, ProfileEscapesAwkwardNames) {
+    {
+        HotSet hot_set(root, profile);
+        record(hot_set, "two\nlines.txt", 5);
+        record(hot_set, "100%.txt", 3);
+        ASSERT_TRUE(hot_set.save());
+    }
+
+    HotSet restarted(root, profile);
+    EXPECT_EQ(restarted.load(), 2u);
+    const auto entries = restarted.hottest();
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_EQ(entries[0].path, "two\nlines.txt");
+    EXPECT_EQ(entries[1].path, "100%.txt");
+}
+
+TEST_F(HotSetTest, ProfilePathsStayInsideTheRoot) {
+    std::ofstream(profile) << "# tinyfs hot set v2\n9 ../../etc/passwd\n8 a/%2E%2E/%2E%2E/secret\n7 assets/../a.html\n";
+
+    HotSet hot_set(root, profile);
+    EXPECT_EQ(hot_set.load(), 1u);
+    const auto entries = hot_set.hottest();
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].path, "a.html");
+}
+
+TEST_F(HotSetTest, MissingOrForeignProfileLoadsNothing) {
+    HotSet hot_set(root, profile);
+    EXPECT_EQ(hot_set.load(), 0u);
+
+    std::ofstream(profile) << "not a profile\n5 a.html\n";
+    EXPECT_EQ(hot_set.load(), 0u);
+}
+
+TEST_F(HotSetTest, WarmupFollowsHeatWithinBudget) {
+    write("hot.js", 400);
+    write("big.bin", 5000);
+    write("warm.css", 300);
+    write("cold.html", 400);
+    {
+        HotSet hot_set(root, profile);
+        record(hot_set, "hot.js", 40);
+        record(hot_set, "big.bin", 30);
+        record(hot_set, "gone.txt", 25);
+        record(hot_set, "warm.css", 20);
+        record(hot_set, "cold.html", 10);
+        ASSERT_TRUE(hot_set.save());
+    }
+
+    HotSet restarted(root, profile);
+    restarted.load();
+    std::vector<std::string> loaded;
+    restarted.start(std::chrono::seconds(3600), 1000, [&](const fs::path &path) { loaded.push_back(path.filename().string()); });
+    wait_for_warmup(restarted);
+
+    // big.bin does not fit and gone.txt is gone, the colder files behind them still do
+    EXPECT_EQ(loaded, (std::vector<std::string>{"hot.js", "warm.css"}));
+    const auto status = restarted.warmup_status();
+    EXPECT_FALSE(status.running);
+    EXPECT_EQ(status.planned, 5u);
+    EXPECT_EQ(status.files, 2u);
+    EXPECT_EQ(status.bytes, 700u);
+    EXPECT_EQ(status.budget, 1000u);
+}
+
+TEST_F(HotSetTest, WarmupJsonReportsProgress) {
+    HotSet hot_set(root, profile);
+    record(hot_set, "a\"b", 2);
+
+    const std::string json = warmup_response_json(hot_set, 10);
+    EXPECT_NE(json.find(R"("running":false)"), std::string::npos);
+    EXPECT_NE(json.find(R"({"path":"a\"b","count":2})"), std::string::npos);
+}
@@ -1,29 +1,69 @@
+#include "cas.hpp"
+#include "handover.hpp"
+#include "hotset.hpp"
+#include "pipeline.hpp"
+#include "prefetch.hpp"
+#include "ratelimit.hpp"
+#include "search.hpp"
+#include "tls.hpp"
+#include "trace.hpp"
+#include "urlpath.hpp"
 #include "utils.hpp"
 #include <atomic>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/system.hpp>
+#include <condition_variable>
 #include <csignal>
 #include <cstdlib>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <sys/socket.h>
 #include <thread>
+#include <unistd.h>
+#include <unordered_set>
 #include <vector>
 
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
 
 std::atomic<bool> SHUTDOWN_REQUESTED{false};
+constexpr size_t PREFETCH_MAX_FILES = 32;
+constexpr size_t PREFETCH_QUEUE_CAPACITY = 64;
+std::unique_ptr<PrefetchQueue> PREFETCH_QUEUE;
+std::shared_ptr<PathIndex> PATH_INDEX;
+std::shared_ptr<ContentStore> CONTENT_STORE;
+std::shared_ptr<HotSet> HOT_SET;
+constexpr size_t WARMUP_LIST_LIMIT = 50;
+const std::string CAS_PREFIX = "/__cas/";
+constexpr size_t PIPELINE_BATCH_BYTES = 1024 * 1024;
+// the server's own state files below the storage root, relative; never served, listed or indexed
+std::unordered_set<std::string> INTERNAL_FILES;
+
+// registers a state file and the temporary it is rewritten through
+void add_internal_file(const fs::path &files_dir, const fs::path &file) {
+    const fs::path rel = file.lexically_normal().lexically_relative(files_dir.lexically_normal());
+    if (rel.empty() || *rel.begin() == "..") {
+        return;
+    }
+    INTERNAL_FILES.insert(rel.generic_string());
+    INTERNAL_FILES.insert(rel.generic_string() + ".tmp");
+}
 
 std::string generate_directory_listing(const std::string &dir_path, const std::string &url_path) {
     std::string html = R"(
     <!DOCTYPE html>
     <html><head><title>Directory Listing</title></head>
     <body>
-        <div class="header"><h1>Directory Listing for )" +
-                       url_path + R"(</h1> </div>
+        <div class="header"><h1>Directory Listing for )";
+    append_html_escaped(html, url_path);
+    html += R"(</h1> </div>
         <div class="file-list">
     )";
 
@@ -37,35 +77,46 @@ std::string generate_directory_listing(const std::string &dir_path, const std::s
         } else {
             parent = "/";
         }
-        html += R"(<div class="file-item directory"><a href=")" + parent + R"(">.. (Parent Directory)</a></div>)";
+        html += R"(<div class="file-item directory"><a href=")";
+        append_url_escaped(html, parent);
+        html += R"(">.. (Parent Directory)</a></div>)";
     }
 
     try {
         if (fs::exists(dir_path) && fs::is_directory(dir_path)) {
-            std::vector<fs::directory_entry> entries;
+            // stat each entry once, the sort below would otherwise stat on every comparison
+            std::vector<std::pair<bool, std::string>> entries;
+            const std::string rel_dir = url_path.size() > 1 ? url_path.substr(1) + "/" : std::string();
             for (const auto &entry : fs::directory_iterator(dir_path)) {
-                entries.push_back(entry);
+                boost::system::error_code ec;
+                const bool is_dir = fs::is_directory(entry.status(ec));
+                std::string name = entry.path().filename().string();
+                if (!is_dir && INTERNAL_FILES.count(rel_dir + name) != 0) {
+                    continue;
+                }
+                entries.emplace_back(is_dir, std::move(name));
             }
 
-            std::sort(entries.begin(), entries.end(), [](const fs::directory_entry &a, const fs::directory_entry &b) {
-                if (fs::is_directory(a) != fs::is_directory(b)) {
-                    return fs::is_directory(a);
+            std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+                if (a.first != b.first) {
+                    return a.first;
                 }
-                return a.path().filename() < b.path().filename();
+                return a.second < b.second;
             });
 
-            for (const auto &entry : entries) {
-                std::string name = entry.path().filename().string();
-                std::string link_path = url_path;
-                if (link_path.back() != '/')
-                    link_path += "/";
-                link_path += name;
-
-                if (fs::is_directory(entry)) {
-                    html += R"(<div class="file-item directory"><a href=")" + link_path + R"("> )" + name + R"( (Directory) /</a></div>)";
-                } else {
-                    html += R"(<div class="file-item file"><a href=")" + link_path + R"("> )" + name + R"( (File) </a></div>)";
-                }
+            std::string link_path = url_path;
+            if (link_path.back() != '/')
+                link_path += "/";
+            html.reserve(html.size() + entries.size() * 128);
+            for (const auto &[is_dir, name] : entries) {
+                html += R"(<div class="file-item )";
+                html += is_dir ? "directory" : "file";
+                html += R"("><a href=")";
+                append_url_escaped(html, link_path);
+                append_url_escaped(html, name);
+                html += R"("> )";
+                append_html_escaped(html, name);
+                html += is_dir ? R"( (Directory) /</a></div>)" : R"( (File) </a></div>)";
             }
         }
     } catch (const std::exception &e) {
@@ -77,7 +128,29 @@ std::string generate_directory_listing(const std::string &dir_path, const std::s
     return html;
 }
 
-void handle_request(http::request<http::string_body> &req, http::response<http::string_body> &res, const fs::path &files_dir, const ServerConfig &config) {
+// goes through the content store when enabled, so identical files share one cached body; nullptr on error
+std::shared_ptr<const std::string> read_body(const fs::path &path, const ServerConfig &config) {
+    if (!CONTENT_STORE) {
+        return std::make_shared<const std::string>(read_file(path.string(), config));
+    }
+    return CONTENT_STORE->read(path, config);
+}
+
+void handle_cas_request(const std::string &hash, Response &res, const ServerConfig &config) {
+    const fs::path path = is_content_hash(hash) ? CONTENT_STORE->path_for(hash) : fs::path();
+    std::string actual;
+    const auto body = path.empty() ? nullptr : CONTENT_STORE->read(path, config, &actual);
+    // the file may have changed since path_for(), never serve other content under this hash
+    if (!body || actual != hash) {
+        set_response_404(res);
+        return;
+    }
+    set_response_200(res, body, get_mime_type(path.string()));
+    res.set(http::field::cache_control, "public, max-age=31536000, immutable");
+    res.set(http::field::etag, "\"" + hash + "\"");
+}
+
+void handle_request(http::request<http::string_body> &req, Response &res, const fs::path &files_dir, const ServerConfig &config) {
     logger->info("Received {} request for {}", req.method_string(), req.target());
     if (req.method() != http::verb::get) {
         logger->warn("Method not allowed: {}", req.method_string());
@@ -85,39 +158,76 @@ void handle_request(http::request<http::string_body> &req, http::response<http::
         return;
     }
 
+    const std::string target = std::string(req.target());
+    if (target == "/__trace" && trace_enabled()) {
+        set_response_200(res, trace_dump_chrome_json(), "application/json");
+        return;
+    }
+    if (PATH_INDEX && (target == "/__search" || target.rfind("/__search?", 0) == 0)) {
+        set_response_200(res, search_response_json(*PATH_INDEX, target), "application/json");
+        return;
+    }
+    if (HOT_SET && target == "/__warmup") {
+        set_response_200(res, warmup_response_json(*HOT_SET, WARMUP_LIST_LIMIT), "application/json");
+        return;
+    }
+    if (CONTENT_STORE && config.cas_route && target.rfind(CAS_PREFIX, 0) == 0) {
+        handle_cas_request(target.substr(CAS_PREFIX.size()), res, config);
+        return;
+    }
+
     try {
-        std::string target = std::string(req.target());
-        fs::path file_path = files_dir / target.substr(1);
-        if (!fs::exists(file_path)) {
+        std::string rel_path;
+        if (!traced("resolve_path", [&]() { return normalize_request_path(target, rel_path); })) {
+            logger->warn("Rejected request path: {}", target);
+            set_response_403(res);
+            return;
+        }
+        const fs::path file_path = files_dir / rel_path;
+        // the CAS index and hot set profile (and their temporaries) are internal state, not content
+        if (INTERNAL_FILES.count(rel_path) != 0) {
+            set_response_404(res);
+            return;
+        }
+        if (!traced("fs::exists", [&]() { return fs::exists(file_path); })) {
             logger->warn("File not found: {}", file_path.string());
             set_response_404(res);
             return;
         }
 
         // directory mode
-        if (fs::is_directory(file_path)) {
+        if (traced("fs::is_directory", [&]() { return fs::is_directory(file_path); })) {
             fs::path index_path = file_path / "index.html";
-            if (fs::exists(index_path) && fs::is_regular_file(index_path)) {
-                std::string content = read_file(index_path.string(), config);
-                if (!content.empty()) {
-                    set_response_200(res, content, "text/html");
+            if (traced("fs::exists", [&]() { return fs::exists(index_path); }) && traced("fs::is_regular_file", [&]() { return fs::is_regular_file(index_path); })) {
+                auto content = traced("read_file", [&]() { return read_body(index_path, config); });
+                if (content && !content->empty()) {
+                    if (HOT_SET) {
+                        HOT_SET->record(rel_path.empty() ? "index.html" : rel_path + "/index.html");
+                    }
+                    if (PREFETCH_QUEUE && !PREFETCH_QUEUE->submit(content, file_path)) {
+                        logger->debug("Prefetch queue full, skipping references of {}", index_path.string());
+                    }
+                    set_response_200(res, std::move(content), "text/html");
                     return;
                 }
             }
-            std::string listing = generate_directory_listing(file_path.string(), target);
-            set_response_200(res, listing, "text/html");
+            std::string listing = traced("directory_listing", [&]() { return generate_directory_listing(file_path.string(), "/" + rel_path); });
+            set_response_200(res, std::move(listing), "text/html");
             return;
         }
 
         // file mode
-        if (fs::is_regular_file(file_path)) {
-            std::string content = read_file_safe(file_path.string(), config.max_file_size_mb);
-            if (content.empty()) {
+        if (traced("fs::is_regular_file", [&]() { return fs::is_regular_file(file_path); })) {
+            auto content = traced("read_file", [&]() { return read_body(file_path, config); });
+            if (!content || content->empty()) {
                 logger->error("Failed to read file: {}", file_path.string());
                 set_response_500(res);
                 return;
             }
-            set_response_200(res, content, get_mime_type(file_path.string()));
+            if (HOT_SET) {
+                HOT_SET->record(rel_path);
+            }
+            set_response_200(res, std::move(content), get_mime_type(file_path.string()));
             return;
         }
 
@@ -130,22 +240,149 @@ void handle_request(http::request<http::string_body> &req, http::response<http::
     }
 }
 
-void session(tcp::socket socket, const fs::path &files_dir, const ServerConfig &config) {
-    try {
-        beast::flat_buffer buffer;
-        http::request<http::string_body> req;
-        http::read(socket, buffer, req);
+template <class Stream>
+void write_response(Stream &stream, Response &res, RateLimiter &limiter, const std::string &client, const ServerConfig &config) {
+    if (!limiter.limits_bytes()) {
+        http::write(stream, res);
+        return;
+    }
+    http::serializer<false, SharedBody> sr{res};
+    sr.limit(config.write_chunk_kb * 1024);
+    while (!sr.is_done()) {
+        const size_t bytes = http::write_some(stream, sr);
+        limiter.on_bytes_sent(client, bytes, !sr.is_done());
+    }
+}
 
-        http::response<http::string_body> res;
+// answers one request, deciding whether the connection stays open afterwards
+Response answer_request(http::request<http::string_body> &req, const std::string &client, const fs::path &files_dir, const ServerConfig &config, RateLimiter &limiter) {
+    Response res;
+    if (limiter.admit_request(client)) {
         handle_request(req, res, files_dir, config);
+    } else {
+        logger->warn("Rate limit exceeded for {}", client);
+        set_response_429(res);
+    }
+    // a draining server lets clients know to reconnect elsewhere (and send close_notify under TLS)
+    res.keep_alive(req.keep_alive() && !SHUTDOWN_REQUESTED);
+    return res;
+}
+
+// `trace` arrives bound to the first request; every later request gets a trace of its own
+template <class Stream>
+void serve_connection(Stream &stream, const std::string &client, const fs::path &files_dir, const ServerConfig &config, RateLimiter &limiter, std::optional<RequestTrace> &trace) {
+    beast::flat_buffer buffer;
+    auto parser = std::make_unique<http::request_parser<http::string_body>>();
+    bool keep_alive = true;
+    bool first = true;
+    while (keep_alive) {
+        if (!first) {
+            if (buffer.size() == 0 && !wait_readable(stream, static_cast<int>(config.keepalive_timeout_ms))) {
+                logger->debug("Closing idle connection from {}", client);
+                return;
+            }
+            trace.emplace(0);
+        }
+        first = false;
 
-        http::write(socket, res);
+        // block for one request, then pick up whatever the client pipelined behind it
+        beast::error_code ec;
+        traced("read_header", [&]() { return http::read(stream, buffer, *parser, ec); });
+        if (ec == http::error::end_of_stream || ec == ssl::error::stream_truncated || ec == net::error::connection_reset) {
+            return;
+        }
+        if (ec) {
+            throw beast::system_error{ec};
+        }
+        std::vector<Response> batch;
+        size_t batch_bytes = 0;
+        const auto flush = [&]() {
+            if (limiter.limits_bytes()) {
+                for (auto &res : batch) {
+                    traced("write", [&]() { write_response(stream, res, limiter, client, config); });
+                }
+            } else if (!batch.empty()) {
+                traced("write", [&]() { return write_gathered(stream, batch); });
+            }
+            batch.clear();
+            batch_bytes = 0;
+        };
+        bool pipelined = false;
+        do {
+            if (pipelined) {
+                trace.emplace(0);
+            }
+            pipelined = true;
+            auto req = parser->release();
+            auto res = answer_request(req, client, files_dir, config, limiter);
+            keep_alive = res.keep_alive();
+            // a large body goes out on its own, so pipelined requests never pile up big bodies in memory
+            if (SharedBody::size(res.body()) >= PIPELINE_BATCH_BYTES) {
+                flush();
+                batch.push_back(std::move(res));
+                flush();
+            } else {
+                batch_bytes += SharedBody::size(res.body());
+                batch.push_back(std::move(res));
+            }
+            parser = std::make_unique<http::request_parser<http::string_body>>();
+        } while (keep_alive && batch.size() < config.pipeline_depth && batch_bytes < PIPELINE_BATCH_BYTES && parse_buffered(buffer, *parser));
+        // a gathered write is traced under the last request of its batch
+        flush();
+        trace.reset();
+    }
+}
+
+std::string remote_ip(const tcp::socket &socket) {
+    beast::error_code ec;
+    return socket.remote_endpoint(ec).address().to_string();
+}
+
+void session(tcp::socket socket, const fs::path &files_dir, const ServerConfig &config, RateLimiter &limiter, uint64_t accept_ns) {
+    std::optional<RequestTrace> trace(std::in_place, accept_ns);
+    try {
+        serve_connection(socket, remote_ip(socket), files_dir, config, limiter, trace);
         socket.shutdown(tcp::socket::shutdown_send);
     } catch (const std::exception &e) {
         logger->error("Session error: {}", e.what());
     }
 }
 
+// a blocking handshake has no deadline, so it runs on the io_context while this thread keeps the clock
+void tls_handshake(beast::ssl_stream<tcp::socket> &stream, std::chrono::milliseconds timeout) {
+    auto done = stream.async_handshake(ssl::stream_base::server, net::use_future);
+    if (done.wait_for(timeout) == std::future_status::ready) {
+        done.get();
+        return;
+    }
+    // shutting the socket down fails the pending operation, which must finish before the stream goes away
+    ::shutdown(stream.next_layer().native_handle(), SHUT_RDWR);
+    done.wait();
+    throw beast::system_error{net::error::timed_out};
+}
+
+void tls_session(tcp::socket socket, ssl::context &tls_ctx, const fs::path &files_dir, const ServerConfig &config, RateLimiter &limiter, uint64_t accept_ns) {
+    // the handshake is traced as part of the first request
+    std::optional<RequestTrace> trace(std::in_place, accept_ns);
+    try {
+        const std::string client = remote_ip(socket);
+        beast::ssl_stream<tcp::socket> stream(std::move(socket), tls_ctx);
+        traced("tls_handshake", [&]() { return tls_handshake(stream, std::chrono::milliseconds(config.keepalive_timeout_ms)); });
+        logger->debug("{} handshake with {}{}", SSL_get_version(stream.native_handle()), client, SSL_session_reused(stream.native_handle()) ? " (resumed)" : "");
+
+        serve_connection(stream, client, files_dir, config, limiter, trace);
+
+        // clients that drop the connection without close_notify are not an error worth logging
+        beast::error_code ec;
+        stream.shutdown(ec);
+        if (ec && ec != net::error::eof && ec != ssl::error::stream_truncated) {
+            logger->debug("TLS shutdown with {}: {}", client, ec.message());
+        }
+    } catch (const std::exception &e) {
+        logger->error("TLS session error: {}", e.what());
+    }
+}
+
 class ThreadPool {
   public:
     explicit ThreadPool(net::io_context &ioc) : ioc_(ioc) {
@@ -173,40 +410,175 @@ class ThreadPool {
     std::vector<std::thread> threads_;
 };
 
-void run_server(net::io_context &ioc, std::shared_ptr<tcp::acceptor> acceptor, const fs::path &files_dir, const ServerConfig &config) {
-    std::function<void()> do_accept = [&]() {
+/**
+ * Counts session threads that are still serving, so shutdown can wait for them to finish.
+ */
+class ConnectionTracker {
+  public:
+    void enter() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++active_;
+    }
+
+    void leave() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_ == 0) {
+            idle_.notify_all();
+        }
+    }
+
+    size_t active() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return active_;
+    }
+
+    /**
+     * Makes a pending wait_idle() give up right away.
+     */
+    void abandon() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        abandoned_ = true;
+        idle_.notify_all();
+    }
+
+    /**
+     * Blocks until no connection is active, the timeout passes or abandon() is called.
+     * @return True if all connections finished
+     */
+    bool wait_idle(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait_for(lock, timeout, [this]() { return active_ == 0 || abandoned_; });
+        return active_ == 0;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    size_t active_ = 0;
+    bool abandoned_ = false;
+};
+
+// returns false if connections were still active when the drain timed out
+bool run_server(net::io_context &ioc, const net::any_io_executor &strand, std::shared_ptr<tcp::acceptor> acceptor, std::shared_ptr<tcp::acceptor> tls_acceptor, std::shared_ptr<ssl::context> tls_ctx, Takeover &takeover, const fs::path &files_dir, const ServerConfig &config) {
+    auto limiter = std::make_shared<RateLimiter>(config);
+    auto tracker = std::make_shared<ConnectionTracker>();
+    // acceptors, signals and the handover server all run their handlers on `strand`, so closing them never races an accept
+    std::function<void(std::shared_ptr<tcp::acceptor>, std::shared_ptr<ssl::context>)> do_accept = [&](std::shared_ptr<tcp::acceptor> acc, std::shared_ptr<ssl::context> ctx) {
         auto socket = std::make_shared<tcp::socket>(ioc);
-        acceptor->async_accept(*socket, [socket, &do_accept, &files_dir, &config](beast::error_code ec) {
-            if (!ec && !SHUTDOWN_REQUESTED) {
-                std::thread([socket, files_dir, config]() { session(std::move(*socket), files_dir, config); }).detach();
-                do_accept();
-            } else if (ec) {
-                logger->error("Accept error: {}", ec.message());
+        acc->async_accept(*socket, [socket, acc, ctx, &do_accept, &files_dir, &config, limiter, tracker](beast::error_code ec) {
+            if (ec) {
+                if (ec != net::error::operation_aborted) {
+                    logger->error("Accept error: {}", ec.message());
+                }
+                return;
+            }
+            // a connection accepted just before shutdown is still served, only the next accept is skipped
+            const uint64_t accept_ns = trace_enabled() ? trace_now_ns() : 0;
+            tracker->enter();
+            if (ctx) {
+                std::thread([socket, ctx, files_dir, config, limiter, tracker, accept_ns]() {
+                    tls_session(std::move(*socket), *ctx, files_dir, config, *limiter, accept_ns);
+                    tracker->leave();
+                }).detach();
+            } else {
+                std::thread([socket, files_dir, config, limiter, tracker, accept_ns]() {
+                    session(std::move(*socket), files_dir, config, *limiter, accept_ns);
+                    tracker->leave();
+                }).detach();
+            }
+            if (!SHUTDOWN_REQUESTED) {
+                do_accept(acc, ctx);
+            }
+        });
+    };
+    do_accept(acceptor, nullptr);
+    if (tls_acceptor) {
+        do_accept(tls_acceptor, tls_ctx);
+    }
+
+    std::mutex shutdown_mutex;
+    std::condition_variable shutdown_cv;
+    std::unique_ptr<HandoverServer> handover;
+    const auto begin_shutdown = [&](const std::string &reason) {
+        if (SHUTDOWN_REQUESTED.exchange(true)) {
+            logger->warn("{}, stopping without waiting for {} connection(s)", reason, tracker->active());
+            tracker->abandon();
+            return;
+        }
+        logger->info("{}, draining {} connection(s)...", reason, tracker->active());
+        beast::error_code ec;
+        acceptor->close(ec);
+        if (tls_acceptor) {
+            tls_acceptor->close(ec);
+        }
+        if (handover) {
+            handover->close();
+        }
+        std::lock_guard<std::mutex> lock(shutdown_mutex);
+        shutdown_cv.notify_all();
+    };
+
+    // a second SIGINT/SIGTERM skips the drain
+    net::signal_set stop_signals(strand, SIGINT, SIGTERM);
+    std::function<void()> wait_stop_signal = [&]() {
+        stop_signals.async_wait([&](beast::error_code ec, int signal) {
+            if (!ec) {
+                begin_shutdown("Received signal " + std::to_string(signal));
+                wait_stop_signal();
+            }
+        });
+    };
+    wait_stop_signal();
+    if (SHUTDOWN_REQUESTED.exchange(false)) {
+        net::post(strand, [&]() { begin_shutdown("Received signal during startup"); });
+    }
+
+    net::signal_set trace_signals(strand, SIGUSR1);
+    std::function<void()> wait_trace_signal = [&]() {
+        trace_signals.async_wait([&](beast::error_code ec, int) {
+            if (!ec) {
+                trace_dump_to_file(config.trace_file);
+                wait_trace_signal();
             }
         });
     };
-    do_accept();
+    wait_trace_signal();
+
+    if (!config.handover_socket.empty()) {
+        std::vector<int> fds{acceptor->native_handle()};
+        std::string tag = "p";
+        if (tls_acceptor) {
+            fds.push_back(tls_acceptor->native_handle());
+            tag += 't';
+        }
+        handover = std::make_unique<HandoverServer>(strand, config.handover_socket, fds, tag, [&]() { begin_shutdown("Handed over to successor"); });
+    }
+    // accepts are queued, so the predecessor can stop accepting without a gap
+    finish_takeover(takeover);
 
     ThreadPool thread_pool(ioc);
 
-    while (!SHUTDOWN_REQUESTED) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(config.shutdown_poll_ms));
+    {
+        std::unique_lock<std::mutex> lock(shutdown_mutex);
+        shutdown_cv.wait(lock, []() { return SHUTDOWN_REQUESTED.load(); });
+    }
+    const bool drained = tracker->wait_idle(std::chrono::milliseconds(config.drain_timeout_ms));
+    if (!drained) {
+        logger->warn("Cutting off {} connection(s) still active after draining", tracker->active());
     }
 
-    logger->info("Shutting down server...");
-    acceptor->close();
     ioc.stop();
     logger->info("Server shutdown complete");
+    return drained;
 }
 
-void signal_handler(int signal) {
-    logger->info("Received signal {}, initiating graceful shutdown...", signal);
-    SHUTDOWN_REQUESTED = true;
-}
+// until run_server() takes over signal handling, a stop signal only marks shutdown as pending
+void startup_signal_handler(int) { SHUTDOWN_REQUESTED = true; }
 
 void setup_signal_handlers() {
-    std::signal(SIGINT, signal_handler);
-    std::signal(SIGTERM, signal_handler);
+    std::signal(SIGINT, startup_signal_handler);
+    std::signal(SIGTERM, startup_signal_handler);
+    std::signal(SIGUSR1, SIG_IGN);
 }
 
 int main(int argc, char *argv[]) {
@@ -217,11 +589,82 @@ int main(int argc, char *argv[]) {
 
     try {
         ServerConfig config = ServerConfig::load_from_env();
+        trace_configure(config.trace_sample_rate);
+        if (trace_enabled()) {
+            logger->info("Tracing 1 in {} requests, dump with SIGUSR1 to {} or GET /__trace", config.trace_sample_rate, config.trace_file);
+        }
+        const fs::path cas_index_file = files_dir / config.cas_index_file;
+        if (config.content_cache_mb > 0 || config.cas_route) {
+            add_internal_file(files_dir, cas_index_file);
+        }
+        const fs::path hotset_file = files_dir / config.hotset_file;
+        if (config.hotset) {
+            add_internal_file(files_dir, hotset_file);
+        }
+        if (config.search_index) {
+            PATH_INDEX = std::make_shared<PathIndex>(files_dir, INTERNAL_FILES);
+            PATH_INDEX->start(config.search_threads);
+        }
+        if (config.prefetch_references) {
+            PREFETCH_QUEUE = std::make_unique<PrefetchQueue>(files_dir, PREFETCH_QUEUE_CAPACITY, PREFETCH_MAX_FILES);
+        }
+        if (config.content_cache_mb > 0 || config.cas_route) {
+            CONTENT_STORE = std::make_shared<ContentStore>(files_dir, cas_index_file, config.content_cache_mb * 1024 * 1024);
+        }
+        if (config.hotset) {
+            HOT_SET = std::make_shared<HotSet>(files_dir, hotset_file);
+            logger->info("Loaded hot set profile with {} paths, warmup progress at GET /__warmup", HOT_SET->load());
+            // warmed files land in the content cache too, when there is one
+            HOT_SET->start(std::chrono::seconds(config.hotset_persist_s), config.warmup_budget_mb * 1024 * 1024, [config](const fs::path &path) {
+                if (CONTENT_STORE) {
+                    CONTENT_STORE->read(path, config);
+                }
+            });
+        }
         net::io_context ioc{static_cast<int>(std::thread::hardware_concurrency())};
+        const net::any_io_executor strand = net::make_strand(ioc);
         auto const address = net::ip::make_address(config.address);
-        auto acceptor = std::make_shared<tcp::acceptor>(ioc, tcp::endpoint{address, config.port});
-        logger->info("Serving files from {} on {}:{}", files_dir.string(), address.to_string(), config.port);
-        run_server(ioc, acceptor, files_dir, config);
+        std::shared_ptr<ssl::context> tls_ctx;
+        if (!config.tls_cert_file.empty()) {
+            tls_ctx = make_tls_context(config.tls_cert_file, config.tls_key_file, config.tls_session_cache_size);
+        }
+
+        // a running server on the handover socket passes its listeners instead of us binding new ones
+        Takeover takeover = request_takeover(config.handover_socket);
+        std::shared_ptr<tcp::acceptor> acceptor;
+        std::shared_ptr<tcp::acceptor> tls_acceptor;
+        for (size_t i = 0; i < takeover.fds.size(); ++i) {
+            auto &slot = takeover.tag[i] == 't' ? tls_acceptor : acceptor;
+            if (slot || (takeover.tag[i] == 't' && !tls_ctx)) {
+                ::close(takeover.fds[i]);
+                continue;
+            }
+            slot = adopt_listener(strand, takeover.fds[i]);
+        }
+        if (!acceptor) {
+            acceptor = std::make_shared<tcp::acceptor>(strand, tcp::endpoint{address, config.port});
+        }
+        const auto local = acceptor->local_endpoint();
+        logger->info("Serving files from {} on {}:{}", files_dir.string(), local.address().to_string(), local.port());
+
+        if (tls_ctx) {
+            if (!tls_acceptor) {
+                tls_acceptor = std::make_shared<tcp::acceptor>(strand, tcp::endpoint{address, config.tls_port});
+            }
+            const auto tls_local = tls_acceptor->local_endpoint();
+            logger->info("Serving HTTPS on {}:{}", tls_local.address().to_string(), tls_local.port());
+        }
+        if (!run_server(ioc, strand, acceptor, tls_acceptor, tls_ctx, takeover, files_dir, config)) {
+            // cut-off sessions still run on detached threads and use the globals, so skip all destructors
+            if (HOT_SET) {
+                HOT_SET->save();
+            }
+            logger->flush();
+            ::_exit(EXIT_SUCCESS);
+        }
+        HOT_SET.reset();
+        PATH_INDEX.reset();
+        PREFETCH_QUEUE.reset();
 
     } catch (const std::exception &e) {
         if (logger) {
@@ -0,0 +1,94 @@
+#include "pipeline.hpp"
+#include <array>
+#include <cerrno>
+#include <poll.h>
+
+namespace {
+
+constexpr size_t MAX_STATUS = 600;
+
+// "HTTP/1.1 <code> <reason>\r\nServer: TinyFS\r\n" for every status beast knows, built on first use
+const std::array<std::string, MAX_STATUS> &status_prefixes() {
+    static const std::array<std::string, MAX_STATUS> PREFIXES = []() {
+        std::array<std::string, MAX_STATUS> prefixes;
+        for (unsigned code = 100; code < MAX_STATUS; ++code) {
+            const auto status = static_cast<http::status>(code);
+            if (http::int_to_status(code) != http::status::unknown) {
+                prefixes[code] = "HTTP/1.1 " + std::to_string(code) + " " + std::string(http::obsolete_reason(status)) + "\r\nServer: TinyFS\r\n";
+            }
+        }
+        return prefixes;
+    }();
+    return PREFIXES;
+}
+
+bool poll_readable(int fd, int timeout_ms) {
+    pollfd pfd{fd, POLLIN, 0};
+    int ready;
+    do {
+        ready = ::poll(&pfd, 1, timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    return ready > 0;
+}
+
+} // namespace
+
+std::string serialize_header(const Response &res) {
+    const unsigned code = res.result_int();
+    const bool cached = res.version() == 11 && code < MAX_STATUS && !status_prefixes()[code].empty() && res.reason() == http::obsolete_reason(res.result()) && res[http::field::server] == "TinyFS";
+
+    std::string header;
+    header.reserve(256);
+    bool skip_server = false;
+    if (cached) {
+        header = status_prefixes()[code];
+        skip_server = true;
+    } else {
+        header += "HTTP/" + std::to_string(res.version() / 10) + "." + std::to_string(res.version() % 10) + " " + std::to_string(code) + " ";
+        header.append(res.reason().data(), res.reason().size());
+        header += "\r\n";
+    }
+    for (const auto &field : res) {
+        // the cached prefix already carries the Server field
+        if (skip_server && field.name() == http::field::server && field.value() == "TinyFS") {
+            skip_server = false;
+            continue;
+        }
+        header.append(field.name_string().data(), field.name_string().size());
+        header += ": ";
+        header.append(field.value().data(), field.value().size());
+        header += "\r\n";
+    }
+    header += "\r\n";
+    return header;
+}
+
+bool wait_readable(tcp::socket &socket, int timeout_ms) { return poll_readable(socket.native_handle(), timeout_ms); }
+
+bool wait_readable(beast::ssl_stream<tcp::socket> &stream, int timeout_ms) {
+    // records already pulled off the socket never show up in poll()
+    SSL *ssl = stream.native_handle();
+    if (SSL_has_pending(ssl) || BIO_pending(SSL_get_rbio(ssl)) > 0) {
+        return true;
+    }
+    return poll_readable(stream.next_layer().native_handle(), timeout_ms);
+}
+
+bool parse_buffered(beast::flat_buffer &buffer, http::request_parser<http::string_body> &parser) {
+    parser.eager(true);
+    while (buffer.size() > 0 && !parser.is_done()) {
+        beast::error_code ec;
+        const size_t used = parser.put(buffer.data(), ec);
+        buffer.consume(used);
+        if (ec == http::error::need_more) {
+            return false;
+        }
+        if (ec) {
+            throw beast::system_error{ec};
+        }
+        if (used == 0) {
+            return false;
+        }
+    }
+    return parser.is_done();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "tls.hpp"
+#include "utils.hpp"
+#include <boost/asio.hpp>
+#include <boost/beast/ssl.hpp>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+/**
+ * Serializes the header block of a response, status line through the blank line. HTTP/1.1
+ * status lines with the default reason, followed by the `Server: TinyFS` field, are built
+ * once and reused.
+ * @param res The response, its Content-Length must already be prepared
+ * @return The header bytes as they go on the wire
+ */
+std::string serialize_header(const Response &res);
+
+/**
+ * Writes several responses in order with a single gathered write, so a batch of pipelined
+ * responses costs one writev() instead of a syscall per header and body.
+ * @param stream The connection
+ * @param responses Responses to write, in request order
+ * @return Bytes written
+ * @throws boost::system::system_error on write failure
+ */
+template <class Stream>
+size_t write_gathered(Stream &stream, const std::vector<Response> &responses) {
+    std::vector<std::string> headers;
+    headers.reserve(responses.size());
+    for (const auto &res : responses) {
+        headers.push_back(serialize_header(res));
+    }
+    std::vector<net::const_buffer> buffers;
+    buffers.reserve(2 * responses.size());
+    for (size_t i = 0; i < responses.size(); ++i) {
+        buffers.push_back(net::buffer(headers[i]));
+        // bodies are referenced where they live, shared ones included
+        if (SharedBody::size(responses[i].body()) != 0) {
+            buffers.push_back(net::buffer(*responses[i].body()));
+        }
+    }
+    return net::write(stream, buffers);
+}
+
+/**
+ * Waits until the next request can be read from a kept-alive connection.
+ * @param timeout_ms Idle time after which the connection is given up on
+ * @return True if data is buffered or arrives in time, false on timeout
+ */
+bool wait_readable(tcp::socket &socket, int timeout_ms);
+bool wait_readable(beast::ssl_stream<tcp::socket> &stream, int timeout_ms);
+
+/**
+ * Parses the next request from bytes that are already buffered, without reading more.
+ * @param buffer Connection read buffer, parsed bytes are consumed
+ * @param parser Parser for the next request, may already hold part of it
+ * @return True if a whole request was parsed; false if more input is needed, in which case
+ *         whatever was parsed stays in `parser`
+ * @throws boost::system::system_error on malformed input
+ */
+bool parse_buffered(beast::flat_buffer &buffer, http::request_parser<http::string_body> &parser);
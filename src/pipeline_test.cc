@@ -0,0 +1,127 @@
+#include "pipeline.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+Response make_response(http::status status, const std::string &body) {
+    Response res;
+    set_response_generic(res, status, body, "text/plain");
+    return res;
+}
+
+std::string beast_header(const Response &res) {
+    std::ostringstream out;
+    out << res.base();
+    return out.str();
+}
+
+} // namespace
+
+class SerializeHeaderTest : public ::testing::Test {};
+
+TEST_F(SerializeHeaderTest, MatchesBeastForCachedStatusLine) {
+    auto res = make_response(http::status::ok, "hello");
+    res.keep_alive(false);
+
+    EXPECT_EQ(serialize_header(res), beast_header(res));
+}
+
+TEST_F(SerializeHeaderTest, MatchesBeastWithExtraFields) {
+    Response res;
+    set_response_429(res);
+
+    EXPECT_EQ(serialize_header(res), beast_header(res));
+}
+
+TEST_F(SerializeHeaderTest, FallsBackForOtherVersionsAndReasons) {
+    auto res = make_response(http::status::not_found, "x");
+    res.version(10);
+    EXPECT_EQ(serialize_header(res), beast_header(res));
+
+    res.version(11);
+    res.reason("Gone Fishing");
+    EXPECT_EQ(serialize_header(res).rfind("HTTP/1.1 404 Gone Fishing\r\n", 0), 0u);
+    EXPECT_EQ(serialize_header(res), beast_header(res));
+}
+
+class PipelineIoTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        tcp::acceptor acceptor(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0});
+        client.connect(acceptor.local_endpoint());
+        acceptor.accept(server);
+    }
+
+    net::io_context ioc;
+    tcp::socket client{ioc};
+    tcp::socket server{ioc};
+};
+
+TEST_F(PipelineIoTest, GatheredResponsesArriveInOrder) {
+    std::vector<Response> batch;
+    batch.push_back(make_response(http::status::ok, "first"));
+    batch.push_back(make_response(http::status::not_found, ""));
+    batch.push_back(make_response(http::status::ok, "third"));
+    write_gathered(server, batch);
+
+    beast::flat_buffer buffer;
+    for (const auto &expected : batch) {
+        http::response<http::string_body> res;
+        http::read(client, buffer, res);
+        EXPECT_EQ(res.result(), expected.result());
+        EXPECT_EQ(res.body(), *expected.body());
+    }
+}
+
+TEST_F(PipelineIoTest, SharedBodiesAreReferencedNotCopied) {
+    const auto body = std::make_shared<const std::string>(100000, 'x');
+    std::vector<Response> batch(2);
+    set_response_200(batch[0], body, "text/plain");
+    set_response_200(batch[1], body, "text/plain");
+    EXPECT_EQ(batch[0].body().get(), body.get());
+    EXPECT_EQ(batch[1].body().get(), body.get());
+
+    // the gathered write and Beast's own serializer both send the shared bytes
+    std::thread writer([&]() {
+        write_gathered(server, batch);
+        http::write(server, batch[0]);
+    });
+    beast::flat_buffer buffer;
+    for (int i = 0; i < 3; ++i) {
+        http::response<http::string_body> res;
+        http::read(client, buffer, res);
+        EXPECT_EQ(res.body(), *body);
+    }
+    writer.join();
+}
+
+TEST_F(PipelineIoTest, ParsesOnlyCompleteBufferedRequests) {
+    const std::string wire = "GET /a HTTP/1.1\r\nHost: x\r\n\r\nGET /b HTTP/1.1\r\nHost: x\r\n\r\nGET /c HTTP/1.1\r\nHo";
+    net::write(client, net::buffer(wire));
+
+    beast::flat_buffer buffer;
+    http::request_parser<http::string_body> first;
+    http::read(server, buffer, first);
+    EXPECT_EQ(first.get().target(), "/a");
+
+    http::request_parser<http::string_body> second;
+    ASSERT_TRUE(parse_buffered(buffer, second));
+    EXPECT_EQ(second.get().target(), "/b");
+
+    http::request_parser<http::string_body> third;
+    EXPECT_FALSE(parse_buffered(buffer, third));
+
+    // the rest arrives later and completes the partial request
+    net::write(client, net::buffer(std::string("st: x\r\n\r\n")));
+    http::read(server, buffer, third);
+    EXPECT_EQ(third.get().target(), "/c");
+}
+
+TEST_F(PipelineIoTest, WaitReadableTimesOutOnIdleConnection) {
+    EXPECT_FALSE(wait_readable(server, 20));
+
+    net::write(client, net::buffer(std::string("G")));
+    EXPECT_TRUE(wait_readable(server, 1000));
+}
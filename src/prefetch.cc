@@ -0,0 +1,147 @@
+#include "prefetch.hpp"
+#include <cctype>
+#include <fcntl.h>
+#include <string_view>
+#include <unistd.h>
+
+namespace {
+
+bool is_local_reference(std::string_view ref) {
+    if (ref.empty() || ref[0] == '#' || ref.rfind("//", 0) == 0) {
+        return false;
+    }
+    // anything with a scheme (http:, data:, mailto:, javascript:, ...) before the first path separator
+    const auto colon = ref.find(':');
+    const auto slash = ref.find('/');
+    return colon == std::string_view::npos || (slash != std::string_view::npos && slash < colon);
+}
+
+// case-insensitive match of `name=` right before position `pos`, skipping whitespace around '='
+bool attribute_before(std::string_view html, size_t pos, std::string_view name) {
+    size_t i = pos;
+    while (i > 0 && std::isspace(static_cast<unsigned char>(html[i - 1]))) {
+        --i;
+    }
+    if (i == 0 || html[i - 1] != '=') {
+        return false;
+    }
+    --i;
+    while (i > 0 && std::isspace(static_cast<unsigned char>(html[i - 1]))) {
+        --i;
+    }
+    if (i < name.size() + 1) {
+        return false;
+    }
+    const size_t start = i - name.size();
+    for (size_t k = 0; k < name.size(); ++k) {
+        if (std::tolower(static_cast<unsigned char>(html[start + k])) != name[k]) {
+            return false;
+        }
+    }
+    return std::isspace(static_cast<unsigned char>(html[start - 1]));
+}
+
+} // namespace
+
+std::vector<std::string> extract_local_references(const std::string &html, size_t max_refs) {
+    std::vector<std::string> refs;
+    const std::string_view view(html);
+    size_t pos = 0;
+    while (refs.size() < max_refs && (pos = view.find_first_of("\"'", pos)) != std::string_view::npos) {
+        const char quote = view[pos];
+        const size_t end = view.find(quote, pos + 1);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        if (attribute_before(view, pos, "href") || attribute_before(view, pos, "src")) {
+            std::string_view ref = view.substr(pos + 1, end - pos - 1);
+            ref = ref.substr(0, ref.find_first_of("?#"));
+            if (is_local_reference(ref)) {
+                refs.emplace_back(ref);
+            }
+        }
+        pos = end + 1;
+    }
+    return refs;
+}
+
+fs::path resolve_reference(const std::string &ref, const fs::path &dir, const fs::path &root) {
+    const fs::path resolved = (ref[0] == '/' ? root / ref.substr(1) : dir / ref).lexically_normal();
+    const fs::path relative = resolved.lexically_relative(root.lexically_normal());
+    if (relative.empty() || *relative.begin() == "..") {
+        return {};
+    }
+    return resolved;
+}
+
+bool prefetch_file(const fs::path &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+#ifdef POSIX_FADV_WILLNEED
+    const bool issued = ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+#else
+    const bool issued = false;
+#endif
+    ::close(fd);
+    return issued;
+}
+
+size_t prefetch_references(const std::string &html, const fs::path &dir, const fs::path &root, size_t max_files) {
+    size_t prefetched = 0;
+    for (const auto &ref : extract_local_references(html, max_files)) {
+        const fs::path path = resolve_reference(ref, dir, root);
+        boost::system::error_code ec;
+        if (path.empty() || !fs::is_regular_file(path, ec)) {
+            continue;
+        }
+        if (prefetch_file(path)) {
+            ++prefetched;
+        }
+    }
+    if (logger) {
+        logger->debug("Prefetched {} files referenced from {}", prefetched, (dir / "index.html").string());
+    }
+    return prefetched;
+}
+
+PrefetchQueue::PrefetchQueue(fs::path root, size_t capacity, size_t max_files) : root_(std::move(root)), capacity_(capacity), max_files_(max_files), worker_([this]() { run(); }) {}
+
+PrefetchQueue::~PrefetchQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        jobs_.clear();
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+bool PrefetchQueue::submit(std::shared_ptr<const std::string> html, fs::path dir) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || jobs_.size() >= capacity_) {
+            return false;
+        }
+        jobs_.push_back(Job{std::move(html), std::move(dir)});
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void PrefetchQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+        if (stopping_) {
+            return;
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+        prefetch_references(*job.html, job.dir, root_, max_files_);
+        ++completed_;
+        lock.lock();
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "utils.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Extracts local references (`href` and `src` attribute values) from an HTML document.
+ * Absolute and protocol-relative URLs, fragments and data/mailto/javascript links are skipped,
+ * query strings and fragments are stripped.
+ * @param html The document to scan
+ * @param max_refs Stop after this many references
+ * @return References in document order
+ */
+std::vector<std::string> extract_local_references(const std::string &html, size_t max_refs);
+
+/**
+ * Resolves a reference found in `dir/index.html` to a file path.
+ * @param ref Reference as returned by extract_local_references()
+ * @param dir Directory containing the referencing document
+ * @param root Storage root, references may not escape it
+ * @return The resolved path, empty if it escapes `root`
+ */
+fs::path resolve_reference(const std::string &ref, const fs::path &dir, const fs::path &root);
+
+/**
+ * Asks the kernel to start reading a regular file into the page cache, without waiting for it.
+ * @return True if the hint was issued
+ */
+bool prefetch_file(const fs::path &path);
+
+/**
+ * Prefetches every local file referenced by an index document.
+ * @param html Contents of `dir/index.html`
+ * @param dir Directory containing the document
+ * @param root Storage root
+ * @param max_files Upper bound on files to prefetch
+ * @return Number of files prefetched
+ */
+size_t prefetch_references(const std::string &html, const fs::path &dir, const fs::path &root, size_t max_files);
+
+/**
+ * Runs prefetch_references() for served index documents on a single background worker.
+ * The queue is bounded and work that does not fit is dropped, since a prefetch is only a hint.
+ * Destruction discards pending work and joins the worker.
+ */
+class PrefetchQueue {
+  public:
+    /**
+     * @param root Storage root
+     * @param capacity Maximum number of documents waiting to be scanned
+     * @param max_files Upper bound on files prefetched per document
+     */
+    PrefetchQueue(fs::path root, size_t capacity, size_t max_files);
+    ~PrefetchQueue();
+
+    PrefetchQueue(const PrefetchQueue &) = delete;
+    PrefetchQueue &operator=(const PrefetchQueue &) = delete;
+
+    /**
+     * Queues an index document for prefetching.
+     * @param html Contents of `dir/index.html`, usually the body being served
+     * @param dir Directory containing the document
+     * @return False if the queue was full and the work was dropped
+     */
+    bool submit(std::shared_ptr<const std::string> html, fs::path dir);
+
+    /**
+     * @return Number of documents scanned so far
+     */
+    size_t completed() const { return completed_; }
+
+  private:
+    struct Job {
+        std::shared_ptr<const std::string> html;
+        fs::path dir;
+    };
+
+    void run();
+
+    const fs::path root_;
+    const size_t capacity_;
+    const size_t max_files_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    bool stopping_ = false;
+    std::atomic<size_t> completed_{0};
+    std::thread worker_;
+};
@@ -0,0 +1,93 @@
+#include "prefetch.hpp"
+#include <chrono>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <thread>
+
+class ExtractReferencesTest : public ::testing::Test {};
+
+TEST_F(ExtractReferencesTest, FindsHrefAndSrc) {
+    const std::string html = R"(<link rel="stylesheet" href="style.css"><script src='app.js'></script><img SRC = "img/logo.png">)";
+
+    EXPECT_EQ(extract_local_references(html, 10), (std::vector<std::string>{"style.css", "app.js", "img/logo.png"}));
+}
+
+TEST_F(ExtractReferencesTest, SkipsExternalAndSpecialLinks) {
+    const std::string html = R"html(<a href="https://example.com/x.js"></a><a href="//cdn.example.com/y.js"></a><a href="#top"></a><a href="mailto:a@b.c"></a><img src="data:image/png;base64,AAAA"><a href="javascript:void(0)"></a><a href="local.html"></a>)html";
+
+    EXPECT_EQ(extract_local_references(html, 10), (std::vector<std::string>{"local.html"}));
+}
+
+TEST_F(ExtractReferencesTest, StripsQueryAndFragment) {
+    const std::string html = R"(<a href="page.html?v=2#section"></a><script src="/abs/app.js?cache=1"></script>)";
+
+    EXPECT_EQ(extract_local_references(html, 10), (std::vector<std::string>{"page.html", "/abs/app.js"}));
+}
+
+TEST_F(ExtractReferencesTest, IgnoresOtherAttributesAndText) {
+    const std::string html = R"(<div class="x" data-src="nope.js" title='href="fake.js"'>"quoted text"</div>)";
+
+    EXPECT_TRUE(extract_local_references(html, 10).empty());
+}
+
+TEST_F(ExtractReferencesTest, RespectsLimit) {
+    const std::string html = R"(<a href="1"></a><a href="2"></a><a href="3"></a>)";
+
+    EXPECT_EQ(extract_local_references(html, 2).size(), 2u);
+}
+
+class ResolveReferenceTest : public ::testing::Test {
+  protected:
+    fs::path root = "/srv/files";
+};
+
+TEST_F(ResolveReferenceTest, RelativeAndAbsolute) {
+    EXPECT_EQ(resolve_reference("style.css", root / "site", root), root / "site" / "style.css");
+    EXPECT_EQ(resolve_reference("../shared/app.js", root / "site", root), root / "shared" / "app.js");
+    EXPECT_EQ(resolve_reference("/top.js", root / "site", root), root / "top.js");
+}
+
+TEST_F(ResolveReferenceTest, RejectsEscapes) {
+    EXPECT_TRUE(resolve_reference("../../etc/passwd", root / "site", root).empty());
+    EXPECT_TRUE(resolve_reference("/../etc/passwd", root / "site", root).empty());
+    EXPECT_TRUE(resolve_reference("..", root, root).empty());
+}
+
+class PrefetchReferencesTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / fs::unique_path("tinyfs_prefetch_test_%%%%%%");
+        fs::create_directories(root / "site");
+        std::ofstream(root / "site" / "style.css") << "body {}";
+        std::ofstream(root / "shared.js") << "var x;";
+    }
+
+    void TearDown() override { fs::remove_all(root); }
+
+    fs::path root;
+};
+
+TEST_F(PrefetchReferencesTest, PrefetchesExistingLocalFiles) {
+    const std::string html = R"(<link href="style.css"><script src="/shared.js"></script><img src="missing.png"><a href="../../outside.txt"></a>)";
+
+    EXPECT_EQ(prefetch_references(html, root / "site", root, 32), 2u);
+}
+
+TEST_F(PrefetchReferencesTest, PrefetchFileOnMissingPath) { EXPECT_FALSE(prefetch_file(root / "nope")); }
+
+TEST_F(PrefetchReferencesTest, QueueRunsSubmittedWork) {
+    PrefetchQueue queue(root, 4, 32);
+
+    EXPECT_TRUE(queue.submit(std::make_shared<const std::string>(R"(<link href="style.css">)"), root / "site"));
+    for (int i = 0; i < 200 && queue.completed() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(queue.completed(), 1u);
+}
+
+TEST_F(PrefetchReferencesTest, FullQueueDropsWork) {
+    PrefetchQueue queue(root, 0, 32);
+
+    EXPECT_FALSE(queue.submit(std::make_shared<const std::string>(R"(<link href="style.css">)"), root / "site"));
+    EXPECT_EQ(queue.completed(), 0u);
+}
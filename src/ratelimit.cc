@@ -0,0 +1,159 @@
+#include "ratelimit.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+namespace {
+
+constexpr size_t MAX_TRACKED_CLIENTS = 4096; // hard cap, least recently seen clients are evicted first
+constexpr auto CLIENT_IDLE_TIMEOUT = std::chrono::seconds(60);
+
+// one second worth of tokens, but never less than what a single unit of work needs
+double burst_for(double rate, double minimum) { return std::max(rate, minimum); }
+
+} // namespace
+
+TokenBucket::TokenBucket(double rate, double burst, Clock::time_point now) : rate_(rate), burst_(burst), tokens_(burst), last_(now) {}
+
+void TokenBucket::refill(Clock::time_point now) {
+    if (now <= last_) {
+        return;
+    }
+    const double elapsed = std::chrono::duration<double>(now - last_).count();
+    tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+    last_ = now;
+}
+
+bool TokenBucket::try_take(double n, Clock::time_point now) {
+    if (unlimited()) {
+        return true;
+    }
+    refill(now);
+    if (tokens_ < n) {
+        return false;
+    }
+    tokens_ -= n;
+    return true;
+}
+
+bool TokenBucket::can_take(double n, Clock::time_point now) {
+    if (unlimited()) {
+        return true;
+    }
+    refill(now);
+    return tokens_ >= n;
+}
+
+void TokenBucket::charge(double n, Clock::time_point now) {
+    if (unlimited()) {
+        return;
+    }
+    refill(now);
+    tokens_ -= n;
+}
+
+std::chrono::nanoseconds TokenBucket::debt_wait(Clock::time_point now) {
+    if (unlimited()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    refill(now);
+    if (tokens_ >= 0) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return std::chrono::nanoseconds(static_cast<int64_t>(-tokens_ / rate_ * 1e9) + 1);
+}
+
+RateLimiter::ClientState::ClientState(double bytes_rate, double requests_rate, TokenBucket::Clock::time_point now) : bytes(bytes_rate, burst_for(bytes_rate, 1), now), requests(requests_rate, burst_for(requests_rate, 1), now), last_seen(now) {}
+
+RateLimiter::RateLimiter(const ServerConfig &config)
+    : per_client_bytes_rate_(static_cast<double>(config.client_bytes_per_sec)), per_client_requests_rate_(static_cast<double>(config.client_requests_per_sec)), global_bytes_(static_cast<double>(config.global_bytes_per_sec), burst_for(static_cast<double>(config.global_bytes_per_sec), static_cast<double>(config.write_chunk_kb) * 1024)),
+      global_requests_(static_cast<double>(config.global_requests_per_sec), burst_for(static_cast<double>(config.global_requests_per_sec), 1)) {}
+
+std::shared_ptr<RateLimiter::ClientState> RateLimiter::client_state(const std::string &client, TokenBucket::Clock::time_point now) {
+    auto it = clients_.find(client);
+    if (it != clients_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        it->second.state->last_seen = now;
+        return it->second.state;
+    }
+    prune_clients(now);
+    lru_.push_front(client);
+    auto state = std::make_shared<ClientState>(per_client_bytes_rate_, per_client_requests_rate_, now);
+    clients_.emplace(client, ClientEntry{state, lru_.begin()});
+    return state;
+}
+
+void RateLimiter::prune_clients(TokenBucket::Clock::time_point now) {
+    // idle clients collect at the tail; a client still referenced by a connection keeps its debt
+    while (!lru_.empty()) {
+        auto it = clients_.find(lru_.back());
+        if (it->second.state.use_count() > 1 || now - it->second.state->last_seen <= CLIENT_IDLE_TIMEOUT) {
+            break;
+        }
+        clients_.erase(it);
+        lru_.pop_back();
+    }
+    // hard cap: evict least recently seen clients even if they are busy, their connections keep the state alive
+    while (clients_.size() >= MAX_TRACKED_CLIENTS) {
+        clients_.erase(lru_.back());
+        lru_.pop_back();
+    }
+}
+
+size_t RateLimiter::tracked_clients() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clients_.size();
+}
+
+bool RateLimiter::admit_request(const std::string &client) {
+    if (global_requests_.unlimited() && per_client_requests_rate_ <= 0) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = TokenBucket::Clock::now();
+    auto state = client_state(client, now);
+    // check both buckets first so a rejection by one never costs a token in the other
+    if (!state->requests.can_take(1, now) || !global_requests_.can_take(1, now)) {
+        return false;
+    }
+    state->requests.try_take(1, now);
+    global_requests_.try_take(1, now);
+    return true;
+}
+
+void RateLimiter::on_bytes_sent(const std::string &client, size_t bytes, bool more) {
+    if (!limits_bytes()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto now = TokenBucket::Clock::now();
+    auto state = client_state(client, now);
+    state->bytes.charge(static_cast<double>(bytes), now);
+    global_bytes_.charge(static_cast<double>(bytes), now);
+    if (!more) {
+        return;
+    }
+
+    TraceSpan span("rate_wait");
+
+    // pay off the client's own debt first so a throttled client never holds up the global queue
+    for (auto wait = state->bytes.debt_wait(now); wait.count() > 0; wait = state->bytes.debt_wait(now)) {
+        cv_.wait_for(lock, wait);
+        now = TokenBucket::Clock::now();
+    }
+
+    // then take a FIFO ticket on the global bucket, requeueing after every chunk interleaves connections
+    const uint64_t ticket = next_ticket_++;
+    while (true) {
+        if (serving_ticket_ != ticket) {
+            cv_.wait(lock);
+            continue;
+        }
+        const auto wait = global_bytes_.debt_wait(TokenBucket::Clock::now());
+        if (wait.count() == 0) {
+            break;
+        }
+        cv_.wait_for(lock, wait);
+    }
+    ++serving_ticket_;
+    cv_.notify_all();
+}
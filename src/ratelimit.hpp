@@ -0,0 +1,122 @@
+#pragma once
+
+#include "utils.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Classic token bucket. Tokens refill continuously at `rate` per second up to `burst`.
+ * The balance may go negative when a caller is charged after the fact, which delays
+ * the next caller until the debt is paid off. A rate of 0 means unlimited.
+ * Not thread-safe, callers synchronize.
+ */
+class TokenBucket {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate, double burst, Clock::time_point now = Clock::now());
+
+    /**
+     * Takes `n` tokens if the balance covers them.
+     * @return True if the tokens were taken
+     */
+    bool try_take(double n, Clock::time_point now);
+
+    /**
+     * @return True if the balance covers `n` tokens, without taking them
+     */
+    bool can_take(double n, Clock::time_point now);
+
+    /**
+     * Unconditionally takes `n` tokens, possibly going into debt.
+     */
+    void charge(double n, Clock::time_point now);
+
+    /**
+     * @return Time until the balance is non-negative again, zero if it already is
+     */
+    std::chrono::nanoseconds debt_wait(Clock::time_point now);
+
+    bool unlimited() const { return rate_ <= 0; }
+
+  private:
+    void refill(Clock::time_point now);
+
+    double rate_;
+    double burst_;
+    double tokens_;
+    Clock::time_point last_;
+};
+
+/**
+ * Global and per-client request and bandwidth limits.
+ *
+ * Requests are admitted or rejected up front. Bytes are charged after each chunk is written;
+ * a connection with more to send then waits for its own bucket and afterwards queues FIFO on the
+ * global bucket, so concurrent bulk transfers interleave chunk by chunk. The last chunk of a
+ * response never waits, which keeps single-chunk responses at full speed during bulk transfers.
+ */
+class RateLimiter {
+  public:
+    explicit RateLimiter(const ServerConfig &config);
+
+    /**
+     * Number of clients currently tracked, never more than the hard cap.
+     */
+    size_t tracked_clients();
+
+    /**
+     * Counts a request against the global and per-client request rates.
+     * @param client Client identifier, usually the remote IP
+     * @return False if the request should be rejected with 429
+     */
+    bool admit_request(const std::string &client);
+
+    /**
+     * Charges written bytes and, if `more` is set, blocks until the connection may send its next chunk.
+     * @param client Client identifier, usually the remote IP
+     * @param bytes Bytes just written
+     * @param more Whether the response has more chunks to send
+     */
+    void on_bytes_sent(const std::string &client, size_t bytes, bool more);
+
+    /**
+     * @return True if any byte rate limit is configured
+     */
+    bool limits_bytes() const { return !global_bytes_.unlimited() || per_client_bytes_rate_ > 0; }
+
+  private:
+    struct ClientState {
+        ClientState(double bytes_rate, double requests_rate, TokenBucket::Clock::time_point now);
+
+        TokenBucket bytes;
+        TokenBucket requests;
+        TokenBucket::Clock::time_point last_seen;
+    };
+
+    struct ClientEntry {
+        std::shared_ptr<ClientState> state;
+        std::list<std::string>::iterator lru;
+    };
+
+    std::shared_ptr<ClientState> client_state(const std::string &client, TokenBucket::Clock::time_point now);
+    void prune_clients(TokenBucket::Clock::time_point now);
+
+    const double per_client_bytes_rate_;
+    const double per_client_requests_rate_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    TokenBucket global_bytes_;
+    TokenBucket global_requests_;
+    std::unordered_map<std::string, ClientEntry> clients_;
+    std::list<std::string> lru_; // most recently seen client first
+    uint64_t next_ticket_ = 0;
+    uint64_t serving_ticket_ = 0;
+};
@@ -0,0 +1,169 @@
+#include "ratelimit.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+class TokenBucketTest : public ::testing::Test {
+  protected:
+    TokenBucket::Clock::time_point start = TokenBucket::Clock::now();
+};
+
+TEST_F(TokenBucketTest, StartsFullAndDrains) {
+    TokenBucket bucket(10, 5, start);
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_TRUE(bucket.try_take(1, start));
+    }
+    EXPECT_FALSE(bucket.try_take(1, start));
+}
+
+TEST_F(TokenBucketTest, RefillsOverTime) {
+    TokenBucket bucket(10, 5, start);
+    EXPECT_TRUE(bucket.try_take(5, start));
+
+    EXPECT_FALSE(bucket.try_take(1, start + std::chrono::milliseconds(50)));
+    EXPECT_TRUE(bucket.try_take(1, start + std::chrono::milliseconds(100)));
+}
+
+TEST_F(TokenBucketTest, RefillIsCappedAtBurst) {
+    TokenBucket bucket(10, 5, start);
+    EXPECT_TRUE(bucket.try_take(5, start));
+
+    EXPECT_FALSE(bucket.try_take(6, start + std::chrono::seconds(10)));
+    EXPECT_TRUE(bucket.try_take(5, start + std::chrono::seconds(10)));
+}
+
+TEST_F(TokenBucketTest, ChargeGoesIntoDebt) {
+    TokenBucket bucket(100, 100, start);
+    bucket.charge(300, start);
+
+    const auto wait = bucket.debt_wait(start);
+    EXPECT_GE(wait, std::chrono::seconds(2));
+    EXPECT_LT(wait, std::chrono::milliseconds(2001));
+    EXPECT_EQ(bucket.debt_wait(start + std::chrono::seconds(2) + std::chrono::milliseconds(1)).count(), 0);
+}
+
+TEST_F(TokenBucketTest, ZeroRateIsUnlimited) {
+    TokenBucket bucket(0, 0, start);
+    bucket.charge(1e12, start);
+
+    EXPECT_TRUE(bucket.unlimited());
+    EXPECT_TRUE(bucket.try_take(1e12, start));
+    EXPECT_EQ(bucket.debt_wait(start).count(), 0);
+}
+
+class RateLimiterTest : public ::testing::Test {
+  protected:
+    ServerConfig config;
+};
+
+TEST_F(RateLimiterTest, UnlimitedByDefault) {
+    RateLimiter limiter(config);
+
+    EXPECT_FALSE(limiter.limits_bytes());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(limiter.admit_request("10.0.0.1"));
+    }
+}
+
+TEST_F(RateLimiterTest, PerClientRequestLimit) {
+    config.client_requests_per_sec = 3;
+    RateLimiter limiter(config);
+
+    EXPECT_TRUE(limiter.admit_request("10.0.0.1"));
+    EXPECT_TRUE(limiter.admit_request("10.0.0.1"));
+    EXPECT_TRUE(limiter.admit_request("10.0.0.1"));
+    EXPECT_FALSE(limiter.admit_request("10.0.0.1"));
+
+    // other clients have their own bucket
+    EXPECT_TRUE(limiter.admit_request("10.0.0.2"));
+}
+
+TEST_F(RateLimiterTest, GlobalRequestLimit) {
+    config.global_requests_per_sec = 2;
+    RateLimiter limiter(config);
+
+    EXPECT_TRUE(limiter.admit_request("10.0.0.1"));
+    EXPECT_TRUE(limiter.admit_request("10.0.0.2"));
+    EXPECT_FALSE(limiter.admit_request("10.0.0.3"));
+}
+
+TEST_F(RateLimiterTest, GlobalRejectionKeepsClientToken) {
+    config.global_requests_per_sec = 10;
+    config.client_requests_per_sec = 1;
+    RateLimiter limiter(config);
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_TRUE(limiter.admit_request("10.0.1." + std::to_string(i)));
+    }
+    EXPECT_FALSE(limiter.admit_request("10.0.0.1"));
+
+    // the global bucket refills within 150ms, the client's own bucket would need a full second
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_TRUE(limiter.admit_request("10.0.0.1"));
+}
+
+TEST_F(RateLimiterTest, ClientMapIsCapped) {
+    config.client_requests_per_sec = 1;
+    RateLimiter limiter(config);
+
+    for (int i = 0; i < 10000; ++i) {
+        limiter.admit_request("client-" + std::to_string(i));
+    }
+    EXPECT_LE(limiter.tracked_clients(), 4096u);
+
+    // the most recent client is still tracked and still out of tokens
+    EXPECT_FALSE(limiter.admit_request("client-9999"));
+}
+
+TEST_F(RateLimiterTest, LastChunkNeverWaits) {
+    config.global_bytes_per_sec = 1024;
+    RateLimiter limiter(config);
+
+    const auto start = TokenBucket::Clock::now();
+    limiter.on_bytes_sent("10.0.0.1", 1024 * 1024, false);
+    EXPECT_LT(TokenBucket::Clock::now() - start, std::chrono::milliseconds(50));
+}
+
+TEST_F(RateLimiterTest, BulkTransferIsShaped) {
+    config.client_bytes_per_sec = 100 * 1024;
+    RateLimiter limiter(config);
+
+    // burst covers the first 100 KiB, the remaining 50 KiB need about half a second
+    const auto start = TokenBucket::Clock::now();
+    limiter.on_bytes_sent("10.0.0.1", 50 * 1024, true);
+    limiter.on_bytes_sent("10.0.0.1", 50 * 1024, true);
+    limiter.on_bytes_sent("10.0.0.1", 50 * 1024, true);
+    const auto elapsed = TokenBucket::Clock::now() - start;
+
+    EXPECT_GE(elapsed, std::chrono::milliseconds(450));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1500));
+}
+
+TEST_F(RateLimiterTest, ConcurrentTransfersShareGlobalBandwidth) {
+    config.global_bytes_per_sec = 200 * 1024;
+    config.write_chunk_kb = 16;
+    RateLimiter limiter(config);
+    limiter.on_bytes_sent("10.0.0.100", 200 * 1024, false);
+
+    std::vector<TokenBucket::Clock::duration> finished(2);
+    const auto start = TokenBucket::Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < finished.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            const std::string client = "10.0.0." + std::to_string(t + 1);
+            for (int i = 0; i < 5; ++i) {
+                limiter.on_bytes_sent(client, 16 * 1024, true);
+            }
+            finished[t] = TokenBucket::Clock::now() - start;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // with the burst drained, 160 KiB at 200 KiB/s take 800 ms and both finish together rather than one after the other
+    const auto gap = finished[0] > finished[1] ? finished[0] - finished[1] : finished[1] - finished[0];
+    EXPECT_GE(std::max(finished[0], finished[1]), std::chrono::milliseconds(700));
+    EXPECT_LT(gap, std::chrono::milliseconds(250));
+}
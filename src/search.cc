@@ -0,0 +1,630 @@
+#include "search.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <string_view>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t INOTIFY_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+constexpr int WATCH_POLL_MS = 250;
+constexpr auto PROGRESS_INTERVAL = std::chrono::seconds(2);
+constexpr size_t MIN_DELTA_BEFORE_REBUILD = 4096;
+constexpr size_t MAX_REMOVED_PREFIXES = 64;
+constexpr size_t MAX_SEARCH_LIMIT = 10000;
+constexpr size_t MAX_COUNTED_MATCHES = 10000;
+constexpr uint32_t TRIGRAM_SPACE = 1u << 24;
+
+uint32_t trigram_at(std::string_view s, size_t i) { return (static_cast<uint32_t>(static_cast<unsigned char>(s[i])) << 16) | (static_cast<uint32_t>(static_cast<unsigned char>(s[i + 1])) << 8) | static_cast<unsigned char>(s[i + 2]); }
+
+bool starts_with(std::string_view s, std::string_view prefix) { return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0; }
+
+double to_mib(size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+// directories still to be listed, shared by the walker threads of one build
+struct WalkQueue {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<fs::path, std::string>> dirs;
+    size_t pending = 0; // queued plus currently being listed
+    bool done = false;
+};
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string decode_query_component(std::string_view in) {
+    std::string out;
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.size() && hex_value(in[i + 1]) >= 0 && hex_value(in[i + 2]) >= 0) {
+            out += static_cast<char>(hex_value(in[i + 1]) * 16 + hex_value(in[i + 2]));
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+std::string query_param(std::string_view target, std::string_view name) {
+    const auto qpos = target.find('?');
+    if (qpos == std::string_view::npos) {
+        return {};
+    }
+    std::string_view query = target.substr(qpos + 1);
+    while (!query.empty()) {
+        const auto amp = query.find('&');
+        const std::string_view pair = query.substr(0, amp);
+        const auto eq = pair.find('=');
+        if (pair.substr(0, eq) == name) {
+            return eq == std::string_view::npos ? std::string() : decode_query_component(pair.substr(eq + 1));
+        }
+        if (amp == std::string_view::npos) {
+            break;
+        }
+        query.remove_prefix(amp + 1);
+    }
+    return {};
+}
+
+} // namespace
+
+struct PathIndex::Snapshot {
+    std::string arena;                     // all paths back to back, sorted
+    std::vector<uint64_t> offsets;         // path i is arena[offsets[i], offsets[i + 1])
+    std::vector<uint32_t> trigram_keys;    // sorted distinct trigrams
+    std::vector<uint64_t> posting_offsets; // postings of trigram_keys[k] are postings[posting_offsets[k], posting_offsets[k + 1])
+    std::vector<uint32_t> postings;        // path ids, ascending per trigram
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    std::string_view path(size_t i) const { return std::string_view(arena).substr(offsets[i], offsets[i + 1] - offsets[i]); }
+
+    // first path id not less than `key`
+    size_t lower_bound(std::string_view key) const {
+        size_t lo = 0;
+        size_t hi = size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (path(mid) < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // first path id at or after `begin` that does not start with `prefix`; matches are contiguous in sorted order
+    size_t prefix_end(size_t begin, std::string_view prefix) const {
+        size_t lo = begin;
+        size_t hi = size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (starts_with(path(mid), prefix)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    bool contains(std::string_view key) const {
+        const size_t i = lower_bound(key);
+        return i < size() && path(i) == key;
+    }
+
+    std::pair<const uint32_t *, const uint32_t *> posting(uint32_t key) const {
+        const auto it = std::lower_bound(trigram_keys.begin(), trigram_keys.end(), key);
+        if (it == trigram_keys.end() || *it != key) {
+            return {nullptr, nullptr};
+        }
+        const auto k = static_cast<size_t>(it - trigram_keys.begin());
+        return {postings.data() + posting_offsets[k], postings.data() + posting_offsets[k + 1]};
+    }
+
+    size_t memory_bytes() const { return arena.capacity() + offsets.capacity() * sizeof(uint64_t) + trigram_keys.capacity() * sizeof(uint32_t) + posting_offsets.capacity() * sizeof(uint64_t) + postings.capacity() * sizeof(uint32_t); }
+
+    static std::shared_ptr<const Snapshot> build(std::vector<std::string> paths) {
+        std::sort(paths.begin(), paths.end());
+        paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+        auto snapshot = std::make_shared<Snapshot>();
+        size_t arena_size = 0;
+        for (const auto &p : paths) {
+            arena_size += p.size();
+        }
+        snapshot->arena.reserve(arena_size);
+        snapshot->offsets.reserve(paths.size() + 1);
+        for (const auto &p : paths) {
+            snapshot->offsets.push_back(snapshot->arena.size());
+            snapshot->arena += p;
+        }
+        snapshot->offsets.push_back(snapshot->arena.size());
+        paths.clear();
+        paths.shrink_to_fit();
+
+        if (snapshot->size() == 0) {
+            snapshot->posting_offsets.push_back(0);
+            return snapshot;
+        }
+
+        // two passes over the paths, so the transient cost is one counter per possible trigram
+        // instead of a (trigram, id) pair per posting: count postings per trigram, then fill them in
+        std::vector<uint32_t> slots(TRIGRAM_SPACE, 0);
+        std::vector<uint32_t> grams;
+        const auto distinct_grams = [&](size_t id) {
+            const std::string_view p = snapshot->path(id);
+            grams.clear();
+            for (size_t i = 0; i + 3 <= p.size(); ++i) {
+                grams.push_back(trigram_at(p, i));
+            }
+            std::sort(grams.begin(), grams.end());
+            grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        };
+        for (size_t id = 0; id < snapshot->size(); ++id) {
+            distinct_grams(id);
+            for (const uint32_t g : grams) {
+                ++slots[g];
+            }
+        }
+
+        // counts become offsets, and each slot is reused to map its trigram to a key index
+        uint64_t total = 0;
+        for (uint32_t g = 0; g < TRIGRAM_SPACE; ++g) {
+            if (slots[g] == 0) {
+                continue;
+            }
+            snapshot->posting_offsets.push_back(total);
+            total += slots[g];
+            slots[g] = static_cast<uint32_t>(snapshot->trigram_keys.size());
+            snapshot->trigram_keys.push_back(g);
+        }
+        snapshot->posting_offsets.push_back(total);
+
+        // ids are visited in ascending order, which keeps every posting list sorted
+        std::vector<uint64_t> cursors(snapshot->posting_offsets.begin(), snapshot->posting_offsets.end() - 1);
+        snapshot->postings.resize(total);
+        for (size_t id = 0; id < snapshot->size(); ++id) {
+            distinct_grams(id);
+            for (const uint32_t g : grams) {
+                snapshot->postings[cursors[slots[g]]++] = static_cast<uint32_t>(id);
+            }
+        }
+        snapshot->trigram_keys.shrink_to_fit();
+        snapshot->posting_offsets.shrink_to_fit();
+        return snapshot;
+    }
+};
+
+PathIndex::PathIndex(fs::path root, std::unordered_set<std::string> hidden) : root_(std::move(root)), hidden_(std::move(hidden)), snapshot_(Snapshot::build({})) {}
+
+PathIndex::~PathIndex() {
+    stopping_ = true;
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    if (inotify_fd_ >= 0) {
+        ::close(inotify_fd_);
+    }
+}
+
+void PathIndex::start(unsigned int threads) {
+    inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0 && logger) {
+        logger->warn("inotify unavailable, search index will not follow changes: {}", std::strerror(errno));
+    }
+    worker_ = std::thread([this, threads]() { watch_loop(threads); });
+}
+
+void PathIndex::build(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const auto start = std::chrono::steady_clock::now();
+    scanned_ = 0;
+
+    WalkQueue queue;
+    queue.dirs.emplace_back(root_, std::string());
+    queue.pending = 1;
+    std::vector<std::vector<std::string>> found(threads);
+    std::vector<std::thread> walkers;
+    walkers.reserve(threads);
+    for (unsigned int t = 0; t < threads; ++t) {
+        walkers.emplace_back([this, &queue, &local = found[t]]() {
+            while (true) {
+                std::pair<fs::path, std::string> next;
+                {
+                    std::unique_lock<std::mutex> lock(queue.mutex);
+                    queue.cv.wait(lock, [&]() { return !queue.dirs.empty() || queue.pending == 0 || stopping_; });
+                    if (queue.dirs.empty() || stopping_) {
+                        return;
+                    }
+                    next = std::move(queue.dirs.front());
+                    queue.dirs.pop_front();
+                }
+
+                // watch before listing so nothing created in between is missed
+                add_watch(next.first, next.second);
+                std::vector<std::pair<fs::path, std::string>> subdirs;
+                boost::system::error_code ec;
+                for (fs::directory_iterator it(next.first, ec), end; !ec && it != end; it.increment(ec)) {
+                    const std::string name = it->path().filename().string();
+                    if (fs::is_directory(it->symlink_status(ec))) {
+                        std::string rel = next.second + name + "/";
+                        local.push_back(rel);
+                        subdirs.emplace_back(it->path(), std::move(rel));
+                    } else if (std::string rel = next.second + name; hidden_.count(rel) == 0) {
+                        local.push_back(std::move(rel));
+                    }
+                    scanned_.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                for (auto &dir : subdirs) {
+                    queue.dirs.push_back(std::move(dir));
+                }
+                queue.pending += subdirs.size();
+                if (--queue.pending == 0) {
+                    queue.done = true;
+                }
+                queue.cv.notify_all();
+            }
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        while (!queue.cv.wait_for(lock, PROGRESS_INTERVAL, [&]() { return queue.done || stopping_; })) {
+            if (logger) {
+                logger->info("Indexing {}: {} paths scanned, {} directories queued", root_.string(), scanned_.load(), queue.dirs.size());
+            }
+        }
+        queue.cv.notify_all();
+    }
+    for (auto &walker : walkers) {
+        walker.join();
+    }
+
+    std::vector<std::string> paths;
+    size_t total = 0;
+    for (const auto &local : found) {
+        total += local.size();
+    }
+    paths.reserve(total);
+    for (auto &local : found) {
+        std::move(local.begin(), local.end(), std::back_inserter(paths));
+        local.clear();
+        local.shrink_to_fit();
+    }
+    auto snapshot = Snapshot::build(std::move(paths));
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        snapshot_ = snapshot;
+        // keep only the part of the delta that the fresh walk may have raced with
+        for (auto it = added_.begin(); it != added_.end();) {
+            it = snapshot->contains(*it) ? added_.erase(it) : std::next(it);
+        }
+        for (auto it = removed_.begin(); it != removed_.end();) {
+            it = snapshot->contains(*it) ? std::next(it) : removed_.erase(it);
+        }
+        removed_prefixes_.erase(std::remove_if(removed_prefixes_.begin(), removed_prefixes_.end(),
+                                               [&](const std::string &prefix) {
+                                                   const size_t i = snapshot->lower_bound(prefix);
+                                                   return i >= snapshot->size() || !starts_with(snapshot->path(i), prefix);
+                                               }),
+                                removed_prefixes_.end());
+    }
+    ready_ = true;
+
+    if (logger) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        logger->info("Indexed {} paths under {} in {} ms ({:.1f} MiB)", snapshot->size(), root_.string(), elapsed, to_mib(snapshot->memory_bytes()));
+    }
+}
+
+void PathIndex::add_watch(const fs::path &dir, const std::string &rel_dir) {
+    if (inotify_fd_ < 0) {
+        return;
+    }
+    const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(), INOTIFY_MASK);
+    if (wd < 0) {
+        static std::atomic<bool> warned{false};
+        if (errno == ENOSPC && !warned.exchange(true) && logger) {
+            logger->warn("Out of inotify watches, raise fs.inotify.max_user_watches to follow the whole tree");
+        }
+        return;
+    }
+    std::lock_guard<std::mutex> lock(watches_mutex_);
+    watches_[wd] = rel_dir;
+}
+
+void PathIndex::walk_into_delta(const fs::path &dir, const std::string &rel_dir) {
+    add_watch(dir, rel_dir);
+    boost::system::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (fs::is_directory(it->symlink_status(ec))) {
+            note_added(rel_dir + name + "/");
+            walk_into_delta(it->path(), rel_dir + name + "/");
+        } else {
+            note_added(rel_dir + name);
+        }
+    }
+}
+
+void PathIndex::watch_loop(unsigned int threads) {
+    build(threads);
+    if (inotify_fd_ < 0) {
+        return;
+    }
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    while (!stopping_) {
+        pollfd pfd{inotify_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, WATCH_POLL_MS) <= 0) {
+            continue;
+        }
+
+        bool rebuild = false;
+        ssize_t len;
+        while ((len = ::read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+            for (char *p = buffer; p < buffer + len;) {
+                const auto *event = reinterpret_cast<const struct inotify_event *>(p);
+                p += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    rebuild = true;
+                    continue;
+                }
+                std::string rel_dir;
+                {
+                    std::lock_guard<std::mutex> lock(watches_mutex_);
+                    const auto it = watches_.find(event->wd);
+                    if (it == watches_.end()) {
+                        continue;
+                    }
+                    if (event->mask & IN_IGNORED) {
+                        watches_.erase(it);
+                        continue;
+                    }
+                    rel_dir = it->second;
+                }
+                if (event->len == 0) {
+                    continue;
+                }
+
+                const std::string rel = rel_dir + event->name;
+                const bool is_dir = event->mask & IN_ISDIR;
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    note_added(is_dir ? rel + "/" : rel);
+                    if (is_dir) {
+                        walk_into_delta(root_ / rel, rel + "/");
+                    }
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    note_removed(is_dir ? rel + "/" : rel);
+                }
+            }
+        }
+
+        if (rebuild || delta_needs_rebuild()) {
+            build(threads);
+        }
+    }
+}
+
+bool PathIndex::hidden_by_removed_prefix(std::string_view path) const {
+    return std::any_of(removed_prefixes_.begin(), removed_prefixes_.end(), [&](const std::string &prefix) { return starts_with(path, prefix); });
+}
+
+bool PathIndex::delta_needs_rebuild() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return added_.size() + removed_.size() > std::max(MIN_DELTA_BEFORE_REBUILD, snapshot_->size() / 8) || removed_prefixes_.size() > MAX_REMOVED_PREFIXES;
+}
+
+void PathIndex::note_added(const std::string &rel_path) {
+    if (hidden_.count(rel_path) != 0) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    removed_.erase(rel_path);
+    if (snapshot_->contains(rel_path) && !hidden_by_removed_prefix(rel_path)) {
+        return;
+    }
+    added_.insert(rel_path);
+}
+
+void PathIndex::note_removed(const std::string &rel_path) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    added_.erase(rel_path);
+    if (!rel_path.empty() && rel_path.back() == '/') {
+        for (auto it = added_.begin(); it != added_.end();) {
+            it = starts_with(*it, rel_path) ? added_.erase(it) : std::next(it);
+        }
+        removed_prefixes_.push_back(rel_path);
+        return;
+    }
+    if (snapshot_->contains(rel_path)) {
+        removed_.insert(rel_path);
+    }
+}
+
+std::vector<std::string> PathIndex::search(const std::string &query, Mode mode, size_t limit, size_t *total, bool *total_capped) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    const Snapshot &snapshot = *snapshot_;
+    std::vector<std::string> results;
+    size_t count = 0;
+    bool capped = false;
+    // broad queries stop counting here, so a one-letter query never walks every match
+    const size_t count_limit = std::max(limit, MAX_COUNTED_MATCHES);
+
+    const bool pending_removals = !removed_.empty() || !removed_prefixes_.empty();
+    const auto visible = [&](std::string_view path) { return !pending_removals || (removed_.find(path) == removed_.end() && !hidden_by_removed_prefix(path)); };
+    // false once enough matches are counted
+    const auto take = [&](std::string_view path) {
+        if (!visible(path)) {
+            return true;
+        }
+        if (count == count_limit) {
+            capped = true;
+            return false;
+        }
+        ++count;
+        if (results.size() < limit) {
+            results.emplace_back(path);
+        }
+        return true;
+    };
+
+    if (mode == Mode::Prefix) {
+        const size_t begin = snapshot.lower_bound(query);
+        const size_t end = snapshot.prefix_end(begin, query);
+        if (!pending_removals) {
+            // the match range is exact, only the returned paths need to be copied
+            count = end - begin;
+            for (size_t i = begin; i < end && results.size() < limit; ++i) {
+                results.emplace_back(snapshot.path(i));
+            }
+        } else {
+            for (size_t i = begin; i < end && take(snapshot.path(i)); ++i) {
+            }
+        }
+    } else if (query.size() < 3) {
+        for (size_t i = 0; i < snapshot.size(); ++i) {
+            if (snapshot.path(i).find(query) != std::string_view::npos && !take(snapshot.path(i))) {
+                break;
+            }
+        }
+    } else {
+        // intersect posting lists starting from the rarest trigram, then confirm the full substring
+        std::vector<std::pair<const uint32_t *, const uint32_t *>> lists;
+        for (size_t i = 0; i + 3 <= query.size(); ++i) {
+            const auto list = snapshot.posting(trigram_at(query, i));
+            if (list.first == nullptr) {
+                lists.clear();
+                break;
+            }
+            lists.push_back(list);
+        }
+        if (!lists.empty()) {
+            std::sort(lists.begin(), lists.end(), [](const auto &a, const auto &b) { return a.second - a.first < b.second - b.first; });
+            std::vector<uint32_t> candidates(lists[0].first, lists[0].second);
+            for (size_t l = 1; l < lists.size() && !candidates.empty(); ++l) {
+                std::vector<uint32_t> next;
+                std::set_intersection(candidates.begin(), candidates.end(), lists[l].first, lists[l].second, std::back_inserter(next));
+                candidates.swap(next);
+            }
+            for (const uint32_t id : candidates) {
+                if (snapshot.path(id).find(query) != std::string_view::npos && !take(snapshot.path(id))) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // the delta is small, scan it and merge
+    std::vector<std::string> extra;
+    for (const auto &path : added_) {
+        const bool match = mode == Mode::Prefix ? starts_with(path, query) : path.find(query) != std::string::npos;
+        if (match) {
+            extra.push_back(path);
+        }
+    }
+    if (!extra.empty()) {
+        count += extra.size();
+        std::sort(extra.begin(), extra.end());
+        std::vector<std::string> merged;
+        merged.reserve(std::min(limit, results.size() + extra.size()));
+        std::merge(std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()), std::make_move_iterator(extra.begin()), std::make_move_iterator(extra.end()), std::back_inserter(merged));
+        if (merged.size() > limit) {
+            merged.resize(limit);
+        }
+        results.swap(merged);
+    }
+
+    if (total != nullptr) {
+        *total = count;
+    }
+    if (total_capped != nullptr) {
+        *total_capped = capped;
+    }
+    return results;
+}
+
+PathIndex::Status PathIndex::status() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    Status status;
+    status.ready = ready_;
+    status.scanned = scanned_;
+    status.entries = snapshot_->size() + added_.size() - std::min(snapshot_->size(), removed_.size());
+    status.memory_bytes = snapshot_->memory_bytes();
+    for (const auto &path : added_) {
+        status.memory_bytes += sizeof(std::string) + path.capacity() + 2 * sizeof(void *);
+    }
+    for (const auto &path : removed_) {
+        status.memory_bytes += sizeof(std::string) + path.capacity() + 4 * sizeof(void *);
+    }
+    return status;
+}
+
+std::string search_response_json(const PathIndex &index, const std::string &target) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::string query = query_param(target, "q");
+    const std::string mode_param = query_param(target, "mode");
+    const PathIndex::Mode mode = mode_param == "prefix" ? PathIndex::Mode::Prefix : PathIndex::Mode::Substring;
+    size_t limit = 100;
+    try {
+        const std::string limit_param = query_param(target, "limit");
+        if (!limit_param.empty()) {
+            limit = std::min<size_t>(std::stoul(limit_param), MAX_SEARCH_LIMIT);
+        }
+    } catch (const std::exception &) {
+        // keep the default
+    }
+
+    size_t total = 0;
+    bool total_capped = false;
+    const auto results = index.search(query, mode, limit, &total, &total_capped);
+    const auto status = index.status();
+    const auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::string json = R"({"query":)";
+    append_json_string(json, query);
+    json += R"(,"mode":")";
+    json += mode == PathIndex::Mode::Prefix ? "prefix" : "substring";
+    json += R"(","total":)" + std::to_string(total) + R"(,"results":[)";
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i != 0) {
+            json += ',';
+        }
+        append_json_string(json, results[i]);
+    }
+    json += R"(],"total_capped":)" + std::string(total_capped ? "true" : "false");
+    json += R"(,"ready":)" + std::string(status.ready ? "true" : "false");
+    json += R"(,"entries":)" + std::to_string(status.entries);
+    json += R"(,"scanned":)" + std::to_string(status.scanned);
+    json += R"(,"memory_bytes":)" + std::to_string(status.memory_bytes);
+    json += R"(,"elapsed_us":)" + std::to_string(elapsed_us) + "}";
+    return json;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "utils.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * In-memory index over every path below a storage root, answering prefix and substring
+ * queries without touching the filesystem.
+ *
+ * The bulk of the index is an immutable snapshot: all relative paths sorted in one arena
+ * (directories carry a trailing '/') plus a trigram posting list in CSR form. Changes
+ * reported by inotify land in a small delta on top of the snapshot, which is folded back in
+ * by a background rebuild once it grows.
+ */
+class PathIndex {
+  public:
+    enum class Mode { Prefix, Substring };
+
+    struct Status {
+        bool ready = false;      // The first build has finished
+        size_t entries = 0;      // Paths currently visible to queries
+        size_t scanned = 0;      // Paths seen by the build in progress
+        size_t memory_bytes = 0; // Approximate heap footprint of the index
+    };
+
+    /**
+     * @param root Storage root
+     * @param hidden Relative paths of files that are never indexed, such as the server's own state files
+     */
+    explicit PathIndex(fs::path root, std::unordered_set<std::string> hidden = {});
+    ~PathIndex();
+
+    PathIndex(const PathIndex &) = delete;
+    PathIndex &operator=(const PathIndex &) = delete;
+    PathIndex(PathIndex &&) = delete;
+    PathIndex &operator=(PathIndex &&) = delete;
+
+    /**
+     * Builds the index on a background thread and keeps it current with inotify afterwards.
+     * @param threads Directory walker threads, 0 uses the hardware concurrency
+     */
+    void start(unsigned int threads);
+
+    /**
+     * Walks the whole tree and replaces the snapshot. Blocks until done.
+     * @param threads Directory walker threads, 0 uses the hardware concurrency
+     */
+    void build(unsigned int threads);
+
+    /**
+     * Runs a query against the snapshot and the pending delta.
+     * @param query Prefix of, or substring within, the relative path
+     * @param mode Prefix or substring match
+     * @param limit Maximum number of paths returned
+     * @param total If set, receives the number of matches; counting stops at 10000 or `limit`, whichever is larger
+     * @param total_capped If set, receives whether counting stopped before all matches were seen
+     * @return Matching relative paths in lexicographic order
+     */
+    std::vector<std::string> search(const std::string &query, Mode mode, size_t limit, size_t *total = nullptr, bool *total_capped = nullptr) const;
+
+    Status status() const;
+
+    /**
+     * Records a path that appeared since the last build.
+     * @param rel_path Path relative to the root, directories end in '/'
+     */
+    void note_added(const std::string &rel_path);
+
+    /**
+     * Records a path that disappeared since the last build.
+     * @param rel_path Path relative to the root, directories end in '/' and take their subtree with them
+     */
+    void note_removed(const std::string &rel_path);
+
+  private:
+    struct Snapshot;
+
+    void watch_loop(unsigned int threads);
+    void add_watch(const fs::path &dir, const std::string &rel_dir);
+    void walk_into_delta(const fs::path &dir, const std::string &rel_dir);
+    bool delta_needs_rebuild() const;
+    bool hidden_by_removed_prefix(std::string_view path) const;
+
+    const fs::path root_;
+    const std::unordered_set<std::string> hidden_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> ready_{false};
+    std::atomic<size_t> scanned_{0};
+    std::thread worker_;
+
+    mutable std::shared_mutex mutex_;
+    std::shared_ptr<const Snapshot> snapshot_;
+    std::unordered_set<std::string> added_;
+    std::set<std::string, std::less<>> removed_; // ordered for lookups by string_view
+    std::vector<std::string> removed_prefixes_;
+
+    int inotify_fd_ = -1;
+    std::mutex watches_mutex_;
+    std::unordered_map<int, std::string> watches_;
+};
+
+/**
+ * Answers `GET /__search?q=<query>&mode=prefix|substring&limit=<n>` from the index.
+ * @param index The path index
+ * @param target The request target including the query string
+ * @return JSON document with the matches and the index status
+ */
+std::string search_response_json(const PathIndex &index, const std::string &target);
@@ -0,0 +1,162 @@
+#include "search.hpp"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <gtest/gtest.h>
+#include <thread>
+
+class PathIndexTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / fs::unique_path("tinyfs_search_test_%%%%%%");
+        fs::create_directories(root / "assets" / "js");
+        fs::create_directories(root / "docs");
+        touch("index.html");
+        touch("assets/js/app.js");
+        touch("assets/js/vendor.min.js");
+        touch("assets/logo.png");
+        touch("docs/readme.txt");
+    }
+
+    void TearDown() override { fs::remove_all(root); }
+
+    void touch(const std::string &rel) { std::ofstream(root / rel) << rel; }
+
+    // waits for the inotify watcher to catch up
+    bool eventually(const std::function<bool()> &condition) {
+        for (int i = 0; i < 100; ++i) {
+            if (condition()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return false;
+    }
+
+    fs::path root;
+};
+
+TEST_F(PathIndexTest, IndexesFilesAndDirectories) {
+    PathIndex index(root);
+    index.build(2);
+
+    const auto status = index.status();
+    EXPECT_TRUE(status.ready);
+    EXPECT_EQ(status.entries, 8u);
+    EXPECT_GT(status.memory_bytes, 0u);
+    EXPECT_EQ(index.search("", PathIndex::Mode::Prefix, 100), (std::vector<std::string>{"assets/", "assets/js/", "assets/js/app.js", "assets/js/vendor.min.js", "assets/logo.png", "docs/", "docs/readme.txt", "index.html"}));
+}
+
+TEST_F(PathIndexTest, HiddenFilesAreNotIndexed) {
+    touch("docs/state.idx");
+    PathIndex index(root, {"docs/state.idx", "docs/state.idx.tmp"});
+    index.build(1);
+
+    EXPECT_EQ(index.search("docs/", PathIndex::Mode::Prefix, 100), (std::vector<std::string>{"docs/", "docs/readme.txt"}));
+    index.note_added("docs/state.idx.tmp");
+    EXPECT_TRUE(index.search("state", PathIndex::Mode::Substring, 100).empty());
+}
+
+TEST_F(PathIndexTest, PrefixQuery) {
+    PathIndex index(root);
+    index.build(2);
+
+    EXPECT_EQ(index.search("assets/js/", PathIndex::Mode::Prefix, 100), (std::vector<std::string>{"assets/js/", "assets/js/app.js", "assets/js/vendor.min.js"}));
+    EXPECT_TRUE(index.search("js/", PathIndex::Mode::Prefix, 100).empty());
+}
+
+TEST_F(PathIndexTest, SubstringQuery) {
+    PathIndex index(root);
+    index.build(2);
+
+    EXPECT_EQ(index.search(".js", PathIndex::Mode::Substring, 100), (std::vector<std::string>{"assets/js/app.js", "assets/js/vendor.min.js"}));
+    EXPECT_EQ(index.search("min", PathIndex::Mode::Substring, 100), (std::vector<std::string>{"assets/js/vendor.min.js"}));
+    EXPECT_EQ(index.search("me", PathIndex::Mode::Substring, 100), (std::vector<std::string>{"docs/readme.txt"}));
+    EXPECT_TRUE(index.search("nothing-like-this", PathIndex::Mode::Substring, 100).empty());
+}
+
+TEST_F(PathIndexTest, LimitAndTotal) {
+    PathIndex index(root);
+    index.build(1);
+
+    size_t total = 0;
+    const auto results = index.search("assets", PathIndex::Mode::Substring, 2, &total);
+    EXPECT_EQ(results.size(), 2u);
+    EXPECT_EQ(total, 5u);
+}
+
+TEST_F(PathIndexTest, BroadQueriesStopCounting) {
+    fs::create_directories(root / "many");
+    for (int i = 0; i < 10050; ++i) {
+        std::ofstream(root / "many" / ("f" + std::to_string(i)));
+    }
+    PathIndex index(root);
+    index.build(2);
+
+    size_t total = 0;
+    bool capped = false;
+    EXPECT_EQ(index.search("f", PathIndex::Mode::Substring, 3, &total, &capped), (std::vector<std::string>{"many/f0", "many/f1", "many/f10"}));
+    EXPECT_EQ(total, 10000u);
+    EXPECT_TRUE(capped);
+
+    // without pending removals a prefix range is counted exactly
+    EXPECT_EQ(index.search("many/", PathIndex::Mode::Prefix, 2, &total, &capped).size(), 2u);
+    EXPECT_EQ(total, 10051u);
+    EXPECT_FALSE(capped);
+
+    index.note_removed("many/f0");
+    EXPECT_EQ(index.search("many/", PathIndex::Mode::Prefix, 2, &total, &capped), (std::vector<std::string>{"many/", "many/f1"}));
+    EXPECT_EQ(total, 10000u);
+    EXPECT_TRUE(capped);
+}
+
+TEST_F(PathIndexTest, DeltaOverlaysSnapshot) {
+    PathIndex index(root);
+    index.build(2);
+
+    index.note_added("docs/changelog.txt");
+    index.note_removed("docs/readme.txt");
+    EXPECT_EQ(index.search("docs/", PathIndex::Mode::Prefix, 100), (std::vector<std::string>{"docs/", "docs/changelog.txt"}));
+
+    index.note_removed("assets/js/");
+    EXPECT_EQ(index.search(".js", PathIndex::Mode::Substring, 100), std::vector<std::string>{});
+    EXPECT_EQ(index.search("assets/", PathIndex::Mode::Prefix, 100), (std::vector<std::string>{"assets/", "assets/logo.png"}));
+
+    index.note_added("assets/js/");
+    index.note_added("assets/js/app.js");
+    EXPECT_EQ(index.search("assets/js", PathIndex::Mode::Prefix, 100), (std::vector<std::string>{"assets/js/", "assets/js/app.js"}));
+}
+
+TEST_F(PathIndexTest, FollowsFilesystemChanges) {
+    PathIndex index(root);
+    index.start(2);
+    ASSERT_TRUE(eventually([&]() { return index.status().ready; }));
+
+    touch("docs/new-notes.txt");
+    EXPECT_TRUE(eventually([&]() { return index.search("new-notes", PathIndex::Mode::Substring, 10).size() == 1; }));
+
+    fs::create_directories(root / "fresh" / "nested");
+    touch("fresh/nested/deep.txt");
+    EXPECT_TRUE(eventually([&]() { return index.search("fresh/nested/deep.txt", PathIndex::Mode::Prefix, 10).size() == 1; }));
+
+    fs::remove(root / "docs" / "readme.txt");
+    EXPECT_TRUE(eventually([&]() { return index.search("readme", PathIndex::Mode::Substring, 10).empty(); }));
+
+    fs::remove_all(root / "assets");
+    EXPECT_TRUE(eventually([&]() { return index.search("assets", PathIndex::Mode::Prefix, 10).empty(); }));
+}
+
+TEST_F(PathIndexTest, JsonResponse) {
+    PathIndex index(root);
+    index.build(1);
+
+    const std::string json = search_response_json(index, "/__search?q=app%2Ejs&mode=substring&limit=5");
+    EXPECT_NE(json.find(R"("query":"app.js")"), std::string::npos);
+    EXPECT_NE(json.find(R"("mode":"substring")"), std::string::npos);
+    EXPECT_NE(json.find(R"("total":1,"results":["assets/js/app.js"])"), std::string::npos);
+    EXPECT_NE(json.find(R"("total_capped":false)"), std::string::npos);
+    EXPECT_NE(json.find(R"("ready":true)"), std::string::npos);
+
+    const std::string prefix = search_response_json(index, "/__search?mode=prefix&q=docs");
+    EXPECT_NE(prefix.find(R"("results":["docs/","docs/readme.txt"])"), std::string::npos);
+}
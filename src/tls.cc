@@ -0,0 +1,39 @@
+#include "tls.hpp"
+#include "utils.hpp"
+#include <stdexcept>
+
+namespace {
+
+constexpr unsigned char SESSION_ID_CONTEXT[] = "tinyfs";
+constexpr long SESSION_TIMEOUT_SECONDS = 2 * 60 * 60;
+
+} // namespace
+
+std::shared_ptr<ssl::context> make_tls_context(const std::string &cert_file, const std::string &key_file, size_t session_cache_size) {
+    auto ctx = std::make_shared<ssl::context>(ssl::context::tls_server);
+    ctx->set_options(ssl::context::default_workarounds | ssl::context::no_sslv2 | ssl::context::no_sslv3 | ssl::context::no_tlsv1 | ssl::context::no_tlsv1_1 | ssl::context::single_dh_use);
+
+    try {
+        ctx->use_certificate_chain_file(cert_file);
+        ctx->use_private_key_file(key_file, ssl::context::pem);
+    } catch (const std::exception &e) {
+        const std::string error_msg = "Failed to load TLS certificate " + cert_file + " / key " + key_file + ": " + e.what();
+        if (logger) {
+            logger->error(error_msg);
+        }
+        throw std::runtime_error(error_msg);
+    }
+
+    // session tickets are on by default in OpenSSL; the cache additionally covers TLS 1.2 session IDs
+    SSL_CTX *native = ctx->native_handle();
+    SSL_CTX_clear_options(native, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(native, static_cast<long>(session_cache_size));
+    SSL_CTX_set_timeout(native, SESSION_TIMEOUT_SECONDS);
+    SSL_CTX_set_session_id_context(native, SESSION_ID_CONTEXT, sizeof(SESSION_ID_CONTEXT) - 1);
+
+    if (logger) {
+        logger->info("Loaded TLS certificate {}", cert_file);
+    }
+    return ctx;
+}
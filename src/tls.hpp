@@ -0,0 +1,19 @@
+#pragma once
+
+#include <boost/asio/ssl.hpp>
+#include <memory>
+#include <string>
+
+namespace ssl = boost::asio::ssl;
+
+/**
+ * Creates the server TLS context: TLS 1.2+, certificate chain and private key from PEM files,
+ * stateless session tickets plus a server-side session cache so repeat clients resume
+ * instead of doing a full handshake.
+ * @param cert_file PEM certificate chain
+ * @param key_file PEM private key
+ * @param session_cache_size Maximum number of cached sessions
+ * @return The configured context
+ * @throws std::runtime_error if the certificate or key cannot be loaded
+ */
+std::shared_ptr<ssl::context> make_tls_context(const std::string &cert_file, const std::string &key_file, size_t session_cache_size);
@@ -0,0 +1,127 @@
+#include "tls.hpp"
+#include <boost/asio.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <thread>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace fs = boost::filesystem;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// writes a throwaway self-signed P-256 certificate for "localhost"
+void write_self_signed_cert(const std::string &cert_file, const std::string &key_file) {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    ASSERT_NE(key, nullptr);
+
+    X509 *cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 60 * 60);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    ASSERT_GT(X509_sign(cert, key, EVP_sha256()), 0);
+
+    FILE *cert_out = std::fopen(cert_file.c_str(), "wb");
+    ASSERT_NE(cert_out, nullptr);
+    PEM_write_X509(cert_out, cert);
+    std::fclose(cert_out);
+
+    FILE *key_out = std::fopen(key_file.c_str(), "wb");
+    ASSERT_NE(key_out, nullptr);
+    PEM_write_PrivateKey(key_out, key, nullptr, nullptr, 0, nullptr, nullptr);
+    std::fclose(key_out);
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+} // namespace
+
+class TlsContextTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        test_dir = fs::temp_directory_path() / fs::unique_path("tinyfs_tls_test_%%%%%%");
+        fs::create_directories(test_dir);
+        cert_file = (test_dir / "cert.pem").string();
+        key_file = (test_dir / "key.pem").string();
+        write_self_signed_cert(cert_file, key_file);
+    }
+
+    void TearDown() override { fs::remove_all(test_dir); }
+
+    // one client connection against a one-shot server, returns whether the server resumed the session
+    bool handshake(ssl::context &server_ctx, ssl::context &client_ctx, SSL_SESSION *resume, SSL_SESSION **out_session) {
+        net::io_context ioc;
+        tcp::acceptor acceptor(ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0});
+        bool server_resumed = false;
+
+        std::thread server([&]() {
+            tcp::socket socket(ioc);
+            acceptor.accept(socket);
+            beast::ssl_stream<tcp::socket> stream(std::move(socket), server_ctx);
+            stream.handshake(ssl::stream_base::server);
+            server_resumed = SSL_session_reused(stream.native_handle()) == 1;
+            net::write(stream, net::buffer("ok", 2));
+            beast::error_code ec;
+            stream.shutdown(ec);
+        });
+
+        beast::ssl_stream<tcp::socket> client(ioc, client_ctx);
+        client.next_layer().connect(acceptor.local_endpoint());
+        if (resume != nullptr) {
+            SSL_set_session(client.native_handle(), resume);
+        }
+        client.handshake(ssl::stream_base::client);
+
+        // TLS 1.3 delivers the session ticket after the handshake, reading application data picks it up
+        char reply[2];
+        net::read(client, net::buffer(reply, sizeof(reply)));
+        if (out_session != nullptr) {
+            *out_session = SSL_get1_session(client.native_handle());
+        }
+        beast::error_code ec;
+        client.shutdown(ec);
+        server.join();
+        return server_resumed;
+    }
+
+    fs::path test_dir;
+    std::string cert_file;
+    std::string key_file;
+};
+
+TEST_F(TlsContextTest, LoadsSelfSignedCertificate) { EXPECT_NO_THROW(make_tls_context(cert_file, key_file, 128)); }
+
+TEST_F(TlsContextTest, MissingCertificateThrows) { EXPECT_THROW(make_tls_context((test_dir / "missing.pem").string(), key_file, 128), std::runtime_error); }
+
+TEST_F(TlsContextTest, RejectsLegacyProtocols) {
+    auto ctx = make_tls_context(cert_file, key_file, 128);
+    const auto options = SSL_CTX_get_options(ctx->native_handle());
+
+    EXPECT_TRUE(options & SSL_OP_NO_TLSv1);
+    EXPECT_TRUE(options & SSL_OP_NO_TLSv1_1);
+    EXPECT_FALSE(options & SSL_OP_NO_TICKET);
+}
+
+TEST_F(TlsContextTest, RepeatClientResumesSession) {
+    auto server_ctx = make_tls_context(cert_file, key_file, 128);
+    ssl::context client_ctx(ssl::context::tls_client);
+    client_ctx.set_verify_mode(ssl::verify_none);
+
+    SSL_SESSION *session = nullptr;
+    EXPECT_FALSE(handshake(*server_ctx, client_ctx, nullptr, &session));
+    ASSERT_NE(session, nullptr);
+
+    EXPECT_TRUE(handshake(*server_ctx, client_ctx, session, nullptr));
+    SSL_SESSION_free(session);
+}
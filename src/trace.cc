@@ -0,0 +1,211 @@
+#include "trace.hpp"
+#include "utils.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr size_t TRACE_BUFFER_EVENTS = 4096;
+
+// Slots are written by exactly one thread and read concurrently by the dumper,
+// so every field is an atomic and no lock is taken on the recording path.
+struct TraceSlot {
+    std::atomic<uint64_t> trace_id{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> end_ns{0};
+};
+
+struct TraceBuffer {
+    explicit TraceBuffer(uint32_t buffer_tid) : tid(buffer_tid) {}
+
+    const uint32_t tid;
+    std::atomic<uint64_t> head{0};
+    std::array<TraceSlot, TRACE_BUFFER_EVENTS> slots;
+};
+
+// Buffers are never freed: sessions run on short-lived threads, so a buffer is
+// handed back to the free list when its thread exits and reused by the next one.
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer *> free_list;
+};
+
+TraceRegistry &registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+struct ThreadTraceState {
+    TraceBuffer *buffer = nullptr;
+    uint64_t trace_id = 0;
+
+    ~ThreadTraceState() {
+        if (buffer != nullptr) {
+            auto &reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.free_list.push_back(buffer);
+        }
+    }
+};
+
+thread_local ThreadTraceState THREAD_TRACE;
+
+std::atomic<unsigned int> SAMPLE_RATE{0};
+std::atomic<uint64_t> REQUEST_COUNTER{0};
+
+TraceBuffer *acquire_buffer() {
+    auto &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if (!reg.free_list.empty()) {
+        TraceBuffer *buffer = reg.free_list.back();
+        reg.free_list.pop_back();
+        return buffer;
+    }
+    reg.buffers.push_back(std::make_unique<TraceBuffer>(static_cast<uint32_t>(reg.buffers.size() + 1)));
+    return reg.buffers.back().get();
+}
+
+uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+void trace_configure(unsigned int sample_rate) { SAMPLE_RATE.store(sample_rate, std::memory_order_relaxed); }
+
+bool trace_enabled() { return SAMPLE_RATE.load(std::memory_order_relaxed) != 0; }
+
+uint64_t trace_now_ns() { return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+
+uint64_t trace_begin_request(uint64_t accept_ns) {
+    const unsigned int rate = SAMPLE_RATE.load(std::memory_order_relaxed);
+    if (rate == 0) {
+        THREAD_TRACE.trace_id = 0;
+        return 0;
+    }
+
+    const uint64_t n = REQUEST_COUNTER.fetch_add(1, std::memory_order_relaxed);
+    if (n % rate != 0) {
+        THREAD_TRACE.trace_id = 0;
+        return 0;
+    }
+
+    uint64_t trace_id = mix64(n ^ accept_ns);
+    if (trace_id == 0) {
+        trace_id = 1;
+    }
+    THREAD_TRACE.trace_id = trace_id;
+    if (accept_ns != 0) {
+        trace_record("accept", accept_ns, trace_now_ns());
+    }
+    return trace_id;
+}
+
+void trace_end_request() { THREAD_TRACE.trace_id = 0; }
+
+uint64_t trace_current_id() { return THREAD_TRACE.trace_id; }
+
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns) {
+    const uint64_t trace_id = THREAD_TRACE.trace_id;
+    if (trace_id == 0) {
+        return;
+    }
+    if (THREAD_TRACE.buffer == nullptr) {
+        THREAD_TRACE.buffer = acquire_buffer();
+    }
+
+    TraceBuffer &buffer = *THREAD_TRACE.buffer;
+    const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+    TraceSlot &slot = buffer.slots[index % TRACE_BUFFER_EVENTS];
+    slot.trace_id.store(trace_id, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+std::string trace_id_hex(uint64_t trace_id) {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(trace_id));
+    return std::string(hex, 16);
+}
+
+std::string trace_dump_chrome_json() {
+    std::vector<TraceBuffer *> buffers;
+    {
+        auto &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffers.reserve(reg.buffers.size());
+        for (const auto &buffer : reg.buffers) {
+            buffers.push_back(buffer.get());
+        }
+    }
+
+    std::string json = R"({"displayTimeUnit":"ms","traceEvents":[)";
+    bool first = true;
+    char event[256];
+    for (TraceBuffer *buffer : buffers) {
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const uint64_t begin = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        std::vector<std::pair<uint64_t, std::string>> pending;
+        pending.reserve(static_cast<size_t>(head - begin));
+        for (uint64_t i = begin; i < head; ++i) {
+            const TraceSlot &slot = buffer->slots[i % TRACE_BUFFER_EVENTS];
+            const char *name = slot.name.load(std::memory_order_relaxed);
+            const uint64_t trace_id = slot.trace_id.load(std::memory_order_relaxed);
+            const uint64_t start_ns = slot.start_ns.load(std::memory_order_relaxed);
+            const uint64_t end_ns = slot.end_ns.load(std::memory_order_relaxed);
+            if (name == nullptr || end_ns < start_ns) {
+                continue;
+            }
+            const int len = std::snprintf(event, sizeof(event), R"({"name":"%s","cat":"tinyfs","ph":"X","ts":%.3f,"dur":%.3f,"pid":1,"tid":%u,"args":{"trace_id":"%016llx"}})", name, static_cast<double>(start_ns) / 1000.0, static_cast<double>(end_ns - start_ns) / 1000.0, buffer->tid, static_cast<unsigned long long>(trace_id));
+            if (len > 0 && static_cast<size_t>(len) < sizeof(event)) {
+                pending.emplace_back(i, std::string(event, static_cast<size_t>(len)));
+            }
+        }
+
+        // the writer may have lapped the ring while we were reading (including the slot it is
+        // filling right now), drop everything that could have been overwritten
+        const uint64_t head_after = buffer->head.load(std::memory_order_acquire) + 1;
+        const uint64_t valid_from = head_after > TRACE_BUFFER_EVENTS ? head_after - TRACE_BUFFER_EVENTS : 0;
+        for (const auto &[index, entry] : pending) {
+            if (index < valid_from) {
+                continue;
+            }
+            if (!first) {
+                json += ',';
+            }
+            json += entry;
+            first = false;
+        }
+    }
+    json += "]}";
+    return json;
+}
+
+bool trace_dump_to_file(const std::string &path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        if (logger) {
+            logger->error("Failed to open trace file: {}", path);
+        }
+        return false;
+    }
+    out << trace_dump_chrome_json();
+    if (logger) {
+        logger->info("Wrote trace to {}", path);
+    }
+    return static_cast<bool>(out);
+}
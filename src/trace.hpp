@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Configures request sampling for tracing.
+ * @param sample_rate Trace one in every `sample_rate` requests, 0 disables tracing
+ */
+void trace_configure(unsigned int sample_rate);
+
+/**
+ * @return True if tracing is enabled
+ */
+bool trace_enabled();
+
+/**
+ * Returns a monotonic timestamp in nanoseconds, used as the time base for all spans.
+ */
+uint64_t trace_now_ns();
+
+/**
+ * Decides whether the request handled on this thread is sampled and, if so,
+ * binds a fresh trace ID to the calling thread and records the accept span.
+ * @param accept_ns Timestamp taken when the connection was accepted
+ * @return The trace ID, 0 if the request is not sampled
+ */
+uint64_t trace_begin_request(uint64_t accept_ns);
+
+/**
+ * Unbinds the current trace ID from the calling thread.
+ */
+void trace_end_request();
+
+/**
+ * @return The trace ID bound to the calling thread, 0 if none
+ */
+uint64_t trace_current_id();
+
+/**
+ * Records a completed span for the current trace into the calling thread's buffer.
+ * @param name Static span name, must outlive the process
+ * @param start_ns Span start as returned by trace_now_ns()
+ * @param end_ns Span end as returned by trace_now_ns()
+ */
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+/**
+ * RAII span, records its lifetime under the current trace ID. No-op for unsampled requests.
+ */
+class TraceSpan {
+  public:
+    explicit TraceSpan(const char *name) : name_(name), start_ns_(trace_current_id() != 0 ? trace_now_ns() : 0) {}
+    ~TraceSpan() {
+        if (start_ns_ != 0) {
+            trace_record(name_, start_ns_, trace_now_ns());
+        }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+    TraceSpan(TraceSpan &&) = delete;
+    TraceSpan &operator=(TraceSpan &&) = delete;
+
+  private:
+    const char *name_;
+    uint64_t start_ns_;
+};
+
+/**
+ * RAII request trace: samples and binds a trace for one request and records its "request"
+ * span when it ends. On a kept-alive connection only the first request carries the accept time.
+ */
+class RequestTrace {
+  public:
+    explicit RequestTrace(uint64_t accept_ns) : start_ns_(trace_begin_request(accept_ns) != 0 ? trace_now_ns() : 0) {}
+    ~RequestTrace() {
+        if (start_ns_ != 0) {
+            trace_record("request", start_ns_, trace_now_ns());
+        }
+        trace_end_request();
+    }
+
+    RequestTrace(const RequestTrace &) = delete;
+    RequestTrace &operator=(const RequestTrace &) = delete;
+    RequestTrace(RequestTrace &&) = delete;
+    RequestTrace &operator=(RequestTrace &&) = delete;
+
+  private:
+    uint64_t start_ns_;
+};
+
+/**
+ * Runs `fn` inside a span named `name` and returns its result.
+ */
+template <typename F>
+auto traced(const char *name, F &&fn) {
+    TraceSpan span(name);
+    return fn();
+}
+
+/**
+ * Serializes all buffered spans as Chrome trace-event JSON, loadable by Perfetto and chrome://tracing.
+ * @return JSON document
+ */
+std::string trace_dump_chrome_json();
+
+/**
+ * Writes trace_dump_chrome_json() to a file.
+ * @param path Destination file
+ * @return True on success
+ */
+bool trace_dump_to_file(const std::string &path);
+
+/**
+ * Formats a trace ID as fixed-width lowercase hex.
+ */
+std::string trace_id_hex(uint64_t trace_id);
@@ -0,0 +1,100 @@
+#include "trace.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+class TraceTest : public ::testing::Test {
+  protected:
+    void SetUp() override { trace_configure(1); }
+
+    void TearDown() override {
+        trace_end_request();
+        trace_configure(0);
+    }
+};
+
+TEST_F(TraceTest, DisabledTracingSamplesNothing) {
+    trace_configure(0);
+
+    EXPECT_FALSE(trace_enabled());
+    EXPECT_EQ(trace_begin_request(trace_now_ns()), 0u);
+    EXPECT_EQ(trace_current_id(), 0u);
+}
+
+TEST_F(TraceTest, SampledRequestBindsTraceId) {
+    const uint64_t trace_id = trace_begin_request(trace_now_ns());
+
+    EXPECT_NE(trace_id, 0u);
+    EXPECT_EQ(trace_current_id(), trace_id);
+
+    trace_end_request();
+    EXPECT_EQ(trace_current_id(), 0u);
+}
+
+TEST_F(TraceTest, SampleRateSkipsRequests) {
+    trace_configure(4);
+
+    int sampled = 0;
+    for (int i = 0; i < 40; ++i) {
+        if (trace_begin_request(0) != 0) {
+            ++sampled;
+        }
+        trace_end_request();
+    }
+    EXPECT_EQ(sampled, 10);
+}
+
+TEST_F(TraceTest, SpansAppearInChromeJson) {
+    const uint64_t trace_id = trace_begin_request(trace_now_ns());
+    {
+        TraceSpan span("unit_test_span");
+    }
+    EXPECT_EQ(traced("unit_test_traced", []() { return 42; }), 42);
+    trace_end_request();
+
+    const std::string json = trace_dump_chrome_json();
+    EXPECT_EQ(json.rfind(R"({"displayTimeUnit":"ms","traceEvents":[)", 0), 0u);
+    EXPECT_EQ(json.substr(json.size() - 2), "]}");
+    EXPECT_NE(json.find(R"("name":"accept")"), std::string::npos);
+    EXPECT_NE(json.find(R"("name":"unit_test_span")"), std::string::npos);
+    EXPECT_NE(json.find(R"("name":"unit_test_traced")"), std::string::npos);
+    EXPECT_NE(json.find(trace_id_hex(trace_id)), std::string::npos);
+}
+
+TEST_F(TraceTest, RequestTraceCoversOneRequest) {
+    uint64_t first = 0;
+    {
+        RequestTrace trace(0);
+        first = trace_current_id();
+        EXPECT_NE(first, 0u);
+    }
+    EXPECT_EQ(trace_current_id(), 0u);
+    {
+        RequestTrace trace(0);
+        EXPECT_NE(trace_current_id(), first);
+    }
+
+    const std::string json = trace_dump_chrome_json();
+    EXPECT_NE(json.find(R"("name":"request")"), std::string::npos);
+}
+
+TEST_F(TraceTest, UnsampledSpansAreDropped) {
+    {
+        TraceSpan span("unit_test_unsampled");
+    }
+    EXPECT_EQ(trace_dump_chrome_json().find("unit_test_unsampled"), std::string::npos);
+}
+
+TEST_F(TraceTest, SpansFromExitedThreadsSurvive) {
+    std::thread([]() {
+        trace_begin_request(0);
+        TraceSpan span("unit_test_thread_span");
+    }).join();
+
+    EXPECT_NE(trace_dump_chrome_json().find(R"("name":"unit_test_thread_span")"), std::string::npos);
+}
+
+TEST_F(TraceTest, TraceIdHexIsFixedWidth) {
+    EXPECT_EQ(trace_id_hex(0x1a2b), "0000000000001a2b");
+    EXPECT_EQ(trace_id_hex(0xffffffffffffffffULL), "ffffffffffffffff");
+}
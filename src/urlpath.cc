@@ -0,0 +1,266 @@
+#include "urlpath.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// hex digit value per byte, -1 for anything else
+constexpr std::array<int8_t, 256> HEX_VALUES = []() {
+    std::array<int8_t, 256> values{};
+    for (int c = 0; c < 256; ++c) {
+        values[c] = c >= '0' && c <= '9' ? static_cast<int8_t>(c - '0') : c >= 'a' && c <= 'f' ? static_cast<int8_t>(c - 'a' + 10) : c >= 'A' && c <= 'F' ? static_cast<int8_t>(c - 'A' + 10) : -1;
+    }
+    return values;
+}();
+
+int hex_value(char c) { return HEX_VALUES[static_cast<unsigned char>(c)]; }
+
+bool url_safe(unsigned char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~' || c == '/'; }
+
+const char *html_entity(char c) {
+    switch (c) {
+    case '&':
+        return "&amp;";
+    case '<':
+        return "&lt;";
+    case '>':
+        return "&gt;";
+    case '"':
+        return "&quot;";
+    case '\'':
+        return "&#39;";
+    default:
+        return nullptr;
+    }
+}
+
+// The scanners below return the index of the first byte at or after `pos` that needs
+// attention, or `size`. With SSE2 they test 16 bytes per step; the runs in between are
+// copied in one go by the callers.
+
+#if defined(__SSE2__)
+inline __m128i load16(const char *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+
+// bytes within [lo, hi], unsigned
+inline __m128i in_range(__m128i x, char lo, char hi) { return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(lo)), x), _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(hi)), x)); }
+#endif
+
+size_t find_percent(const char *data, size_t pos, size_t size) {
+#if defined(__SSE2__)
+    const __m128i percent = _mm_set1_epi8('%');
+    for (; pos + 16 <= size; pos += 16) {
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(load16(data + pos), percent));
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    while (pos < size && data[pos] != '%') {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t find_html_special(const char *data, size_t pos, size_t size) {
+#if defined(__SSE2__)
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i apos = _mm_set1_epi8('\'');
+    for (; pos + 16 <= size; pos += 16) {
+        const __m128i x = load16(data + pos);
+        const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, amp), _mm_cmpeq_epi8(x, lt)), _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, gt), _mm_cmpeq_epi8(x, quot)), _mm_cmpeq_epi8(x, apos)));
+        const int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    while (pos < size && html_entity(data[pos]) == nullptr) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t find_url_unsafe(const char *data, size_t pos, size_t size) {
+#if defined(__SSE2__)
+    for (; pos + 16 <= size; pos += 16) {
+        const __m128i x = load16(data + pos);
+        __m128i safe = _mm_or_si128(_mm_or_si128(in_range(x, 'a', 'z'), in_range(x, 'A', 'Z')), in_range(x, '-', '9')); // "-./0-9"
+        safe = _mm_or_si128(safe, _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('_')), _mm_cmpeq_epi8(x, _mm_set1_epi8('~'))));
+        const int mask = ~_mm_movemask_epi8(safe) & 0xffff;
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    while (pos < size && url_safe(static_cast<unsigned char>(data[pos]))) {
+        ++pos;
+    }
+    return pos;
+}
+
+} // namespace
+
+bool append_percent_decoded(std::string &out, std::string_view in) {
+    const char *data = in.data();
+    const size_t size = in.size();
+    // decoding never grows the input, so write straight into the string and trim at the end
+    const size_t base = out.size();
+    out.resize(base + size);
+    char *dst = out.data() + base;
+    size_t pos = 0;
+    bool valid = true;
+    while (pos < size) {
+        // heavily encoded input has escapes back to back, no point scanning for those
+        const size_t next = data[pos] == '%' ? pos : find_percent(data, pos, size);
+        std::memcpy(dst, data + pos, next - pos);
+        dst += next - pos;
+        if (next == size) {
+            break;
+        }
+        const int hi = size - next < 3 ? -1 : hex_value(data[next + 1]);
+        const int lo = size - next < 3 ? -1 : hex_value(data[next + 2]);
+        if (hi < 0 || lo < 0) {
+            valid = false;
+            break;
+        }
+        *dst++ = static_cast<char>(hi << 4 | lo);
+        pos = next + 3;
+    }
+    out.resize(static_cast<size_t>(dst - out.data()));
+    return valid;
+}
+
+void append_html_escaped(std::string &out, std::string_view in) {
+    const char *data = in.data();
+    const size_t size = in.size();
+    size_t pos = 0;
+    while (pos < size) {
+        const size_t next = find_html_special(data, pos, size);
+        out.append(data + pos, next - pos);
+        if (next == size) {
+            break;
+        }
+        out.append(html_entity(data[next]));
+        pos = next + 1;
+    }
+}
+
+void append_url_escaped(std::string &out, std::string_view in) {
+    const char *data = in.data();
+    const size_t size = in.size();
+    size_t pos = 0;
+    while (pos < size) {
+        const size_t next = find_url_unsafe(data, pos, size);
+        out.append(data + pos, next - pos);
+        if (next == size) {
+            break;
+        }
+        const auto c = static_cast<unsigned char>(data[next]);
+        const char escaped[3] = {'%', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf]};
+        out.append(escaped, 3);
+        pos = next + 1;
+    }
+}
+
+bool append_percent_decoded_scalar(std::string &out, std::string_view in) {
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] != '%') {
+            out.push_back(in[i]);
+            continue;
+        }
+        if (in.size() - i < 3) {
+            return false;
+        }
+        const int hi = hex_value(in[i + 1]);
+        const int lo = hex_value(in[i + 2]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out.push_back(static_cast<char>(hi << 4 | lo));
+        i += 2;
+    }
+    return true;
+}
+
+void append_html_escaped_scalar(std::string &out, std::string_view in) {
+    for (const char c : in) {
+        if (const char *entity = html_entity(c)) {
+            out.append(entity);
+        } else {
+            out.push_back(c);
+        }
+    }
+}
+
+void append_url_escaped_scalar(std::string &out, std::string_view in) {
+    for (const char c : in) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (url_safe(byte)) {
+            out.push_back(c);
+        } else {
+            out.push_back('%');
+            out.push_back(HEX_DIGITS[byte >> 4]);
+            out.push_back(HEX_DIGITS[byte & 0xf]);
+        }
+    }
+}
+
+bool normalize_request_path(std::string_view target, std::string &out) {
+    out.clear();
+    if (target.empty() || target[0] != '/') {
+        return false;
+    }
+    // two memchr() passes beat find_first_of(), which tests every byte against every needle
+    for (const char delimiter : {'?', '#'}) {
+        if (const void *found = std::memchr(target.data(), delimiter, target.size())) {
+            target = target.substr(0, static_cast<size_t>(static_cast<const char *>(found) - target.data()));
+        }
+    }
+    if (!append_percent_decoded(out, target) || std::memchr(out.data(), '\0', out.size()) != nullptr) {
+        return false;
+    }
+
+    // rewrite segments in place: the write position never overtakes the read position
+    char *path = out.data();
+    const size_t size = out.size();
+    size_t read = 0;
+    size_t write = 0;
+    while (read < size) {
+        while (read < size && path[read] == '/') {
+            ++read;
+        }
+        const char *slash = static_cast<const char *>(std::memchr(path + read, '/', size - read));
+        const size_t end = slash != nullptr ? static_cast<size_t>(slash - path) : size;
+        const size_t length = end - read;
+        if (length == 0 || (length == 1 && path[read] == '.')) {
+            read = end;
+            continue;
+        }
+        if (length == 2 && path[read] == '.' && path[read + 1] == '.') {
+            if (write == 0) {
+                return false;
+            }
+            const size_t last = std::string_view(path, write).rfind('/');
+            write = last == std::string_view::npos ? 0 : last;
+        } else {
+            if (write > 0) {
+                path[write++] = '/';
+            }
+            std::memmove(path + write, path + read, length);
+            write += length;
+        }
+        read = end;
+    }
+    out.resize(write);
+    return true;
+}
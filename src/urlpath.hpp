@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/**
+ * Turns a request target into a path relative to the storage root: drops the query and
+ * fragment, percent-decodes, collapses empty and `.` segments and resolves `..`.
+ * Writes into `out`, reusing its capacity, so a caller holding on to the string does not allocate.
+ * @param target Origin-form request target, e.g. `/docs/a%20b.txt?x=1`
+ * @param out Receives the relative path without leading or trailing '/', empty for the root
+ * @return False if the target is not origin-form, has a malformed escape, decodes to a NUL
+ *         byte or climbs above the root
+ */
+bool normalize_request_path(std::string_view target, std::string &out);
+
+/**
+ * Percent-decodes `in` onto the end of `out`. '+' is left alone, it only means space in queries.
+ * @return False on a malformed escape, `out` then holds a partial result
+ */
+bool append_percent_decoded(std::string &out, std::string_view in);
+
+/**
+ * Appends `in` with `& < > " '` replaced by character references, safe in text and quoted attributes.
+ */
+void append_html_escaped(std::string &out, std::string_view in);
+
+/**
+ * Appends `in` percent-encoded for an href path: everything except unreserved characters and '/' is escaped.
+ */
+void append_url_escaped(std::string &out, std::string_view in);
+
+/**
+ * Byte-at-a-time reference versions of the above, for tests, fuzzing and benchmarks.
+ */
+bool append_percent_decoded_scalar(std::string &out, std::string_view in);
+void append_html_escaped_scalar(std::string &out, std::string_view in);
+void append_url_escaped_scalar(std::string &out, std::string_view in);
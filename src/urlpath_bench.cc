@@ -0,0 +1,76 @@
+// Throughput of the request path pipeline, vectorized against the scalar reference:
+//   bazel run -c opt //:urlpath_bench
+#include "urlpath.hpp"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+// runs `fn` over all inputs until ~200ms have passed, reports MB/s of input
+void bench(const char *name, const std::vector<std::string> &inputs, const std::function<void(std::string &, std::string_view)> &fn) {
+    size_t bytes = 0;
+    for (const auto &input : inputs) {
+        bytes += input.size();
+    }
+    std::string out;
+    size_t rounds = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    do {
+        for (const auto &input : inputs) {
+            out.clear();
+            fn(out, input);
+        }
+        ++rounds;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(200));
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-34s %9.1f MB/s\n", name, static_cast<double>(bytes * rounds) / seconds / 1e6);
+}
+
+std::vector<std::string> make_inputs(size_t count, size_t length, std::string_view alphabet, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> inputs(count);
+    for (auto &input : inputs) {
+        input.resize(length);
+        for (auto &c : input) {
+            c = alphabet[rng() % alphabet.size()];
+        }
+    }
+    return inputs;
+}
+
+} // namespace
+
+int main() {
+    // 100k listing entries: plain file names with the occasional character needing escaping
+    const auto names = make_inputs(100000, 24, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJ0123456789-_.abcdefghijklmnopqrstuvwxyz &", 1);
+    // long URLs, one with the occasional escape and one with nearly every character encoded
+    std::vector<std::string> sparse_urls;
+    for (const auto &raw : make_inputs(256, 4096, "abcdefghijklmnopqrstuvwxyz0123456789/abcdefghijklmnopqrstuvwxyz ", 2)) {
+        std::string encoded = "/";
+        append_url_escaped(encoded, raw);
+        sparse_urls.push_back(encoded);
+    }
+    std::vector<std::string> urls;
+    for (const auto &raw : make_inputs(256, 4096, "abcdefghijklmnopqrstuvwxyz0123456789 <>\"#%{}|^~[]`", 3)) {
+        std::string encoded = "/";
+        append_url_escaped(encoded, raw);
+        urls.push_back(encoded);
+    }
+
+    bench("html escape, listing names", names, append_html_escaped);
+    bench("html escape scalar, listing names", names, append_html_escaped_scalar);
+    bench("url escape, listing names", names, append_url_escaped);
+    bench("url escape scalar, listing names", names, append_url_escaped_scalar);
+    bench("percent decode, sparse escapes", sparse_urls, [](std::string &out, std::string_view in) { append_percent_decoded(out, in); });
+    bench("percent decode scalar, sparse escapes", sparse_urls, [](std::string &out, std::string_view in) { append_percent_decoded_scalar(out, in); });
+    bench("percent decode, encoded URLs", urls, [](std::string &out, std::string_view in) { append_percent_decoded(out, in); });
+    bench("percent decode scalar, encoded URLs", urls, [](std::string &out, std::string_view in) { append_percent_decoded_scalar(out, in); });
+    bench("normalize, sparse escapes", sparse_urls, [](std::string &out, std::string_view in) { normalize_request_path(in, out); });
+    bench("normalize, encoded URLs", urls, [](std::string &out, std::string_view in) { normalize_request_path(in, out); });
+    return 0;
+}
@@ -0,0 +1,63 @@
+// libFuzzer harness for the request path pipeline:
+//   clang++ -std=c++17 -O1 -g -fsanitize=fuzzer,address,undefined src/urlpath_fuzz.cc src/urlpath.cc -o urlpath_fuzz
+// or `bazel build //:urlpath_fuzz` with clang as the C++ compiler.
+#include "urlpath.hpp"
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+void check(bool condition) {
+    if (!condition) {
+        std::abort();
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const std::string_view input(reinterpret_cast<const char *>(data), size);
+
+    // a normalized path never climbs out of the root or carries empty, '.' or '..' segments
+    std::string path;
+    if (normalize_request_path(input, path)) {
+        check(path.empty() || (path.front() != '/' && path.back() != '/'));
+        check(path.find('\0') == std::string::npos);
+        check(path.find("//") == std::string::npos);
+        size_t start = 0;
+        while (start <= path.size() && !path.empty()) {
+            const size_t end = std::min(path.find('/', start), path.size());
+            const std::string_view segment(path.data() + start, end - start);
+            check(segment != "." && segment != "..");
+            start = end + 1;
+        }
+
+        // normalizing the escaped result again changes nothing
+        std::string target = "/";
+        append_url_escaped(target, path);
+        std::string again;
+        check(normalize_request_path(target, again) && again == path);
+    }
+
+    // the vectorized paths agree with the byte-at-a-time ones
+    std::string fast, slow;
+    check(append_percent_decoded(fast, input) == append_percent_decoded_scalar(slow, input));
+    check(fast == slow);
+
+    fast.clear();
+    slow.clear();
+    append_html_escaped(fast, input);
+    append_html_escaped_scalar(slow, input);
+    check(fast == slow);
+    check(fast.find_first_of("<>\"'") == std::string::npos);
+
+    // escaping for an href decodes back to the input
+    fast.clear();
+    slow.clear();
+    append_url_escaped(fast, input);
+    append_url_escaped_scalar(slow, input);
+    check(fast == slow);
+    std::string decoded;
+    check(append_percent_decoded(decoded, fast) && decoded == input);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "urlpath.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace {
+
+std::string normalized(std::string_view target) {
+    std::string out;
+    EXPECT_TRUE(normalize_request_path(target, out)) << target;
+    return out;
+}
+
+bool rejected(std::string_view target) {
+    std::string out;
+    return !normalize_request_path(target, out);
+}
+
+std::string random_bytes(std::mt19937 &rng, size_t size, std::string_view alphabet) {
+    std::string s(size, '\0');
+    for (auto &c : s) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    return s;
+}
+
+} // namespace
+
+class NormalizeRequestPathTest : public ::testing::Test {};
+
+TEST_F(NormalizeRequestPathTest, DecodesAndStripsQuery) {
+    EXPECT_EQ(normalized("/"), "");
+    EXPECT_EQ(normalized("/docs/a%20b.txt"), "docs/a b.txt");
+    EXPECT_EQ(normalized("/app.js?v=2#top"), "app.js");
+    EXPECT_EQ(normalized("/%E2%9C%93/x"), "\xE2\x9C\x93/x");
+    EXPECT_EQ(normalized("/a+b"), "a+b");
+}
+
+TEST_F(NormalizeRequestPathTest, CollapsesSegments) {
+    EXPECT_EQ(normalized("//a///b/"), "a/b");
+    EXPECT_EQ(normalized("/a/./b/."), "a/b");
+    EXPECT_EQ(normalized("/a/b/../c"), "a/c");
+    EXPECT_EQ(normalized("/a/b/../../c"), "c");
+    EXPECT_EQ(normalized("/a/.."), "");
+    EXPECT_EQ(normalized("/..a/b.."), "..a/b..");
+}
+
+TEST_F(NormalizeRequestPathTest, RejectsEscapesAboveRoot) {
+    EXPECT_TRUE(rejected("/.."));
+    EXPECT_TRUE(rejected("/../etc/passwd"));
+    EXPECT_TRUE(rejected("/a/../../etc/passwd"));
+    EXPECT_TRUE(rejected("/%2e%2e/etc/passwd"));
+    EXPECT_TRUE(rejected("/a/%2E%2E%2f%2e%2e/etc/passwd"));
+}
+
+TEST_F(NormalizeRequestPathTest, RejectsMalformedTargets) {
+    EXPECT_TRUE(rejected(""));
+    EXPECT_TRUE(rejected("*"));
+    EXPECT_TRUE(rejected("http://example.com/a"));
+    EXPECT_TRUE(rejected("/a%2"));
+    EXPECT_TRUE(rejected("/a%zz"));
+    EXPECT_TRUE(rejected("/a%00b"));
+}
+
+TEST_F(NormalizeRequestPathTest, ReusesCapacity) {
+    std::string out;
+    out.reserve(256);
+    const auto *data = out.data();
+    ASSERT_TRUE(normalize_request_path("/some/fairly%20long/path/../file.txt", out));
+    EXPECT_EQ(out, "some/fairly long/file.txt");
+    EXPECT_EQ(out.data(), data);
+}
+
+class EscapeTest : public ::testing::Test {};
+
+TEST_F(EscapeTest, HtmlEscapesSpecialCharacters) {
+    std::string out;
+    append_html_escaped(out, R"(<img src="x" onerror='a&b'>)");
+    EXPECT_EQ(out, "&lt;img src=&quot;x&quot; onerror=&#39;a&amp;b&#39;&gt;");
+}
+
+TEST_F(EscapeTest, UrlEscapesAllButUnreservedAndSlash) {
+    std::string out;
+    append_url_escaped(out, "/dir/a b&c\"?#%\xC3\xA9-._~Z9");
+    EXPECT_EQ(out, "/dir/a%20b%26c%22%3F%23%25%C3%A9-._~Z9");
+}
+
+TEST_F(EscapeTest, UrlEscapeRoundTripsThroughDecode) {
+    const std::string name = "weird name <&> 100%.txt";
+    std::string escaped;
+    append_url_escaped(escaped, name);
+    std::string decoded;
+    ASSERT_TRUE(append_percent_decoded(decoded, escaped));
+    EXPECT_EQ(decoded, name);
+}
+
+TEST_F(EscapeTest, VectorizedMatchesScalar) {
+    std::mt19937 rng(42);
+    const std::string alphabet = "abcXYZ019/-._~ %&<>\"'?#\x7f\x80\xff";
+    for (int round = 0; round < 2000; ++round) {
+        const std::string input = random_bytes(rng, rng() % 80, alphabet);
+
+        std::string fast, slow;
+        append_html_escaped(fast, input);
+        append_html_escaped_scalar(slow, input);
+        EXPECT_EQ(fast, slow);
+
+        fast.clear();
+        slow.clear();
+        append_url_escaped(fast, input);
+        append_url_escaped_scalar(slow, input);
+        EXPECT_EQ(fast, slow);
+
+        fast.clear();
+        slow.clear();
+        EXPECT_EQ(append_percent_decoded(fast, input), append_percent_decoded_scalar(slow, input));
+        EXPECT_EQ(fast, slow);
+    }
+}
@@ -1,13 +1,23 @@
 #include "utils.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <boost/program_options.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
-#include <fstream>
+#include <fcntl.h>
+#include <functional>
 #include <iostream>
 #include <mutex>
+#include <spdlog/pattern_formatter.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <unordered_map>
 
 namespace po = boost::program_options;
@@ -22,27 +32,139 @@ ServerConfig ServerConfig::load_from_env() {
     if (const char *env_addr = std::getenv("TINYFS_ADDRESS")) {
         config.address = env_addr;
     }
-    if (const char *env_poll = std::getenv("TINYFS_POLL_MS")) {
-        config.shutdown_poll_ms = std::stoul(env_poll);
+    if (const char *env_drain = std::getenv("TINYFS_DRAIN_TIMEOUT_MS")) {
+        config.drain_timeout_ms = std::stoul(env_drain);
     }
     if (const char *env_max_size = std::getenv("TINYFS_MAX_FILE_MB")) {
         config.max_file_size_mb = std::stoul(env_max_size);
     }
+    if (const char *env_trace_sample = std::getenv("TINYFS_TRACE_SAMPLE")) {
+        config.trace_sample_rate = std::stoul(env_trace_sample);
+    }
+    if (const char *env_trace_file = std::getenv("TINYFS_TRACE_FILE")) {
+        config.trace_file = env_trace_file;
+    }
+    if (const char *env_rate_bytes = std::getenv("TINYFS_RATE_BYTES")) {
+        config.global_bytes_per_sec = std::stoul(env_rate_bytes);
+    }
+    if (const char *env_rate_requests = std::getenv("TINYFS_RATE_REQUESTS")) {
+        config.global_requests_per_sec = std::stoul(env_rate_requests);
+    }
+    if (const char *env_client_rate_bytes = std::getenv("TINYFS_CLIENT_RATE_BYTES")) {
+        config.client_bytes_per_sec = std::stoul(env_client_rate_bytes);
+    }
+    if (const char *env_client_rate_requests = std::getenv("TINYFS_CLIENT_RATE_REQUESTS")) {
+        config.client_requests_per_sec = std::stoul(env_client_rate_requests);
+    }
+    if (const char *env_chunk = std::getenv("TINYFS_WRITE_CHUNK_KB")) {
+        config.write_chunk_kb = std::max<size_t>(1, std::stoul(env_chunk));
+    }
+    if (const char *env_keepalive = std::getenv("TINYFS_KEEPALIVE_MS")) {
+        config.keepalive_timeout_ms = std::stoul(env_keepalive);
+    }
+    if (const char *env_depth = std::getenv("TINYFS_PIPELINE_DEPTH")) {
+        config.pipeline_depth = std::max<size_t>(1, std::stoul(env_depth));
+    }
+    if (const char *env_tls_cert = std::getenv("TINYFS_TLS_CERT")) {
+        config.tls_cert_file = env_tls_cert;
+    }
+    if (const char *env_tls_key = std::getenv("TINYFS_TLS_KEY")) {
+        config.tls_key_file = env_tls_key;
+    }
+    if (const char *env_tls_port = std::getenv("TINYFS_TLS_PORT")) {
+        config.tls_port = static_cast<unsigned short>(std::stoul(env_tls_port));
+    }
+    if (const char *env_tls_cache = std::getenv("TINYFS_TLS_SESSION_CACHE")) {
+        config.tls_session_cache_size = std::stoul(env_tls_cache);
+    }
+    if (const char *env_readahead = std::getenv("TINYFS_READAHEAD_MIN_KB")) {
+        config.readahead_min_kb = std::stoul(env_readahead);
+    }
+    if (const char *env_drop_cache = std::getenv("TINYFS_DROP_CACHE_MIN_MB")) {
+        config.drop_cache_min_mb = std::stoul(env_drop_cache);
+    }
+    if (const char *env_prefetch = std::getenv("TINYFS_PREFETCH")) {
+        config.prefetch_references = std::string(env_prefetch) == "1";
+    }
+    if (const char *env_search = std::getenv("TINYFS_SEARCH_INDEX")) {
+        config.search_index = std::string(env_search) == "1";
+    }
+    if (const char *env_search_threads = std::getenv("TINYFS_SEARCH_THREADS")) {
+        config.search_threads = std::stoul(env_search_threads);
+    }
+    if (const char *env_content_cache = std::getenv("TINYFS_CONTENT_CACHE_MB")) {
+        config.content_cache_mb = std::stoul(env_content_cache);
+    }
+    if (const char *env_cas = std::getenv("TINYFS_CAS")) {
+        config.cas_route = std::string(env_cas) == "1";
+    }
+    if (const char *env_cas_index = std::getenv("TINYFS_CAS_INDEX")) {
+        config.cas_index_file = env_cas_index;
+    }
+    if (const char *env_hotset = std::getenv("TINYFS_HOTSET")) {
+        config.hotset = std::string(env_hotset) == "1";
+    }
+    if (const char *env_hotset_file = std::getenv("TINYFS_HOTSET_FILE")) {
+        config.hotset_file = env_hotset_file;
+    }
+    if (const char *env_hotset_persist = std::getenv("TINYFS_HOTSET_PERSIST_S")) {
+        config.hotset_persist_s = std::max<unsigned long>(1, std::stoul(env_hotset_persist));
+    }
+    if (const char *env_warmup = std::getenv("TINYFS_WARMUP_MB")) {
+        config.warmup_budget_mb = std::stoul(env_warmup);
+    }
+    if (const char *env_handover = std::getenv("TINYFS_HANDOVER_SOCKET")) {
+        config.handover_socket = env_handover;
+    }
     return config;
 }
 
-void set_response_generic(http::response<http::string_body> &res, http::status status, const std::string &body, const std::string &content_type) {
+void set_response_generic(Response &res, http::status status, std::string body, const std::string &content_type) {
     res.set(http::field::server, "TinyFS");
     res.result(status);
     res.set(http::field::content_type, content_type);
-    res.body() = body;
+    res.body() = std::make_shared<const std::string>(std::move(body));
+    res.prepare_payload();
+}
+void set_response_200(Response &res, std::string body, const std::string &mime_type) { set_response_generic(res, http::status::ok, std::move(body), mime_type); }
+void set_response_200(Response &res, std::shared_ptr<const std::string> body, const std::string &mime_type) {
+    res.set(http::field::server, "TinyFS");
+    res.result(http::status::ok);
+    res.set(http::field::content_type, mime_type);
+    res.body() = std::move(body);
     res.prepare_payload();
 }
-void set_response_200(http::response<http::string_body> &res, const std::string &body, const std::string &mime_type) { set_response_generic(res, http::status::ok, body, mime_type); }
-void set_response_404(http::response<http::string_body> &res) { set_response_generic(res, http::status::not_found, "<html><body><h1>404 Not Found</h1><p>The requested resource was not found.</p></body></html>", "text/html"); }
-void set_response_403(http::response<http::string_body> &res) { set_response_generic(res, http::status::forbidden, "<html><body><h1>403 Forbidden</h1><p>Access denied.</p></body></html>", "text/html"); }
-void set_response_405(http::response<http::string_body> &res) { set_response_generic(res, http::status::method_not_allowed, "<html><body><h1>405 Method Not Allowed</h1><p>This method is not allowed.</p></body></html>", "text/html"); }
-void set_response_500(http::response<http::string_body> &res) { set_response_generic(res, http::status::internal_server_error, "<html><body><h1>500 Internal Server Error</h1><p>Server error occurred.</p></body></html>", "text/html"); }
+void set_response_404(Response &res) { set_response_generic(res, http::status::not_found, "<html><body><h1>404 Not Found</h1><p>The requested resource was not found.</p></body></html>", "text/html"); }
+void set_response_403(Response &res) { set_response_generic(res, http::status::forbidden, "<html><body><h1>403 Forbidden</h1><p>Access denied.</p></body></html>", "text/html"); }
+void set_response_405(Response &res) { set_response_generic(res, http::status::method_not_allowed, "<html><body><h1>405 Method Not Allowed</h1><p>This method is not allowed.</p></body></html>", "text/html"); }
+void set_response_429(Response &res) {
+    set_response_generic(res, http::status::too_many_requests, "<html><body><h1>429 Too Many Requests</h1><p>Rate limit exceeded, try again later.</p></body></html>", "text/html");
+    res.set(http::field::retry_after, "1");
+}
+void set_response_500(Response &res) { set_response_generic(res, http::status::internal_server_error, "<html><body><h1>500 Internal Server Error</h1><p>Server error occurred.</p></body></html>", "text/html"); }
+
+void append_json_string(std::string &out, std::string_view s) {
+    out += '"';
+    for (const char c : s) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
 
 std::string get_mime_type(const std::string &path) {
     static const std::unordered_map<std::string_view, std::string_view> MIME_TYPES = {{".html", "text/html"}, {".htm", "text/html"}, {".css", "text/css"}, {".js", "application/javascript"}, {".json", "application/json"}, {".png", "image/png"}, {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"}, {".gif", "image/gif"}, {".txt", "text/plain"}};
@@ -63,42 +185,126 @@ std::string get_mime_type(const std::string &path) {
     return it != MIME_TYPES.end() ? std::string(it->second) : std::string(DEFAULT_MIME_TYPE);
 }
 
-std::string read_file(const std::string &file_path, const ServerConfig &config) { return read_file_safe(file_path, config.max_file_size_mb); }
+std::string read_file(const std::string &file_path, const ServerConfig &config) {
+    ReadHints hints;
+    hints.readahead_min_bytes = config.readahead_min_kb * 1024;
+    hints.drop_cache_min_bytes = config.drop_cache_min_mb * 1024 * 1024;
+    hints.drop_first_read_only = true;
+    return read_file_safe(file_path, config.max_file_size_mb, hints);
+}
+
+namespace {
+
+constexpr size_t READ_BEFORE_SLOTS = 8192;
+
+// direct-mapped set of path hashes; a collision only forgets a path, which costs one more drop
+std::array<std::atomic<uint64_t>, READ_BEFORE_SLOTS> READ_BEFORE{};
+
+// records the read and reports whether the path had been read before
+bool read_before(const std::string &file_path) {
+    const uint64_t tag = std::hash<std::string>{}(file_path) | 1;
+    return READ_BEFORE[tag % READ_BEFORE_SLOTS].exchange(tag, std::memory_order_relaxed) == tag;
+}
+
+// closes the descriptor on every exit path of read_file_safe
+struct FileDescriptor {
+    explicit FileDescriptor(int descriptor) : fd(descriptor) {}
+    ~FileDescriptor() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    FileDescriptor(const FileDescriptor &) = delete;
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+    int fd;
+};
+
+void advise_sequential(int fd, size_t size) {
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#ifdef __linux__
+    // readahead() queues the whole file up front instead of growing the window as we go
+    ::readahead(fd, 0, size);
+#elif defined(POSIX_FADV_WILLNEED)
+    ::posix_fadvise(fd, 0, static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)size;
+#endif
+}
 
-std::string read_file_safe(const std::string &file_path, size_t max_size_mb) {
+void advise_dontneed(int fd) {
+#ifdef POSIX_FADV_DONTNEED
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#else
+    (void)fd;
+#endif
+}
+
+} // namespace
+
+void mark_read_before(const std::string &file_path) { read_before(file_path); }
+
+std::string read_file_safe(const std::string &file_path, size_t max_size_mb, const ReadHints &hints) {
     try {
-        std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
+        const FileDescriptor file(::open(file_path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (file.fd < 0) {
             if (logger) {
                 logger->error("Failed to open file: {}", file_path);
             }
             return {};
         }
 
-        const auto size = file.tellg();
-        if (size < 0) {
+        struct stat st {};
+        if (::fstat(file.fd, &st) != 0 || st.st_size < 0) {
             if (logger) {
                 logger->error("Failed to get file size: {}", file_path);
             }
             return {};
         }
+        const auto size = static_cast<size_t>(st.st_size);
 
         const size_t max_size_bytes = max_size_mb * 1024 * 1024;
-        if (static_cast<size_t>(size) > max_size_bytes) {
+        if (size > max_size_bytes) {
             if (logger) {
-                logger->warn("File too large: {} ({} bytes, max {} MB)", file_path, static_cast<size_t>(size), max_size_mb);
+                logger->warn("File too large: {} ({} bytes, max {} MB)", file_path, size, max_size_mb);
             }
             return {};
         }
 
-        std::string content;
-        content.reserve(static_cast<size_t>(size));
+        if (size >= hints.readahead_min_bytes) {
+            advise_sequential(file.fd, size);
+        }
 
-        file.seekg(0, std::ios::beg);
-        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        std::string content(size, '\0');
+        size_t offset = 0;
+        while (offset < size) {
+            const ssize_t n = ::read(file.fd, &content[offset], size - offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                if (logger) {
+                    logger->error("Failed to read file: {}", file_path);
+                }
+                return {};
+            }
+            if (n == 0) {
+                break; // truncated while we were reading
+            }
+            offset += static_cast<size_t>(n);
+        }
+        content.resize(offset);
+
+        if (hints.drop_cache_min_bytes != 0 && size >= hints.drop_cache_min_bytes && !(hints.drop_first_read_only && read_before(file_path))) {
+            advise_dontneed(file.fd);
+        }
 
         if (logger) {
-            logger->debug("Successfully read file: {} ({} bytes)", file_path, static_cast<size_t>(size));
+            logger->debug("Successfully read file: {} ({} bytes)", file_path, offset);
         }
         return content;
     } catch (const std::exception &e) {
@@ -183,11 +389,28 @@ void mkdir(const fs::path &dir) {
     }
 }
 
+// `%*` expands to "[trace <id>] " while the logging thread serves a sampled request
+class TraceIdFlag : public spdlog::custom_flag_formatter {
+  public:
+    void format(const spdlog::details::log_msg &, const std::tm &, spdlog::memory_buf_t &dest) override {
+        const uint64_t trace_id = trace_current_id();
+        if (trace_id == 0) {
+            return;
+        }
+        const std::string prefix = "[trace " + trace_id_hex(trace_id) + "] ";
+        dest.append(prefix.data(), prefix.data() + prefix.size());
+    }
+
+    std::unique_ptr<custom_flag_formatter> clone() const override { return spdlog::details::make_unique<TraceIdFlag>(); }
+};
+
 void init_logger() {
     static std::once_flag flag;
     std::call_once(flag, []() {
         logger = spdlog::stdout_color_mt("tinyfs");
         logger->set_level(spdlog::level::info);
-        logger->set_pattern("[%H:%M:%S] [%^%l%$] %v");
+        auto formatter = std::make_unique<spdlog::pattern_formatter>();
+        formatter->add_flag<TraceIdFlag>('*').set_pattern("[%H:%M:%S] [%^%l%$] %*%v");
+        logger->set_formatter(std::move(formatter));
     });
 }
@@ -1,24 +1,90 @@
 #pragma once
 
 #include <boost/beast.hpp>
+#include <boost/optional.hpp>
+#include <cstdint>
 #include <boost/filesystem.hpp>
 #include <memory>
 #include <spdlog/logger.h>
 #include <string>
+#include <string_view>
+#include <utility>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace fs = boost::filesystem;
 
 struct ServerConfig {
-    std::string address = "0.0.0.0";     // The address to bind the server to
-    unsigned short port = 8888;          // The port to listen on
-    unsigned int shutdown_poll_ms = 100; // Polling interval for shutdown
-    size_t max_file_size_mb = 100;       // Maximum file size limit in MB
+    std::string address = "0.0.0.0";               // The address to bind the server to
+    unsigned short port = 8888;                    // The port to listen on
+    unsigned int drain_timeout_ms = 30000;         // How long shutdown waits for in-flight connections to finish
+    size_t max_file_size_mb = 100;                 // Maximum file size limit in MB
+    unsigned int trace_sample_rate = 0;            // Trace one in N requests, 0 disables tracing
+    std::string trace_file = "tinyfs-trace.json";  // Chrome trace output written on SIGUSR1
+    size_t global_bytes_per_sec = 0;               // Total outbound bandwidth limit, 0 is unlimited
+    size_t global_requests_per_sec = 0;            // Total request rate limit, 0 is unlimited
+    size_t client_bytes_per_sec = 0;               // Outbound bandwidth limit per client IP, 0 is unlimited
+    size_t client_requests_per_sec = 0;            // Request rate limit per client IP, 0 is unlimited
+    size_t write_chunk_kb = 64;                    // Responses are written and shaped in chunks of this size
+    unsigned int keepalive_timeout_ms = 5000;      // Idle keep-alive connections and stalled TLS handshakes are closed after this long
+    size_t pipeline_depth = 16;                    // Pipelined requests answered together in one gathered write, bodies of 1 MiB or more go alone
+    std::string tls_cert_file;                     // PEM certificate chain, HTTPS is disabled while empty
+    std::string tls_key_file;                      // PEM private key for tls_cert_file
+    unsigned short tls_port = 8443;                // The port to serve HTTPS on
+    size_t tls_session_cache_size = 20480;         // Server-side TLS sessions kept for resumption
+    size_t readahead_min_kb = 256;                 // Files at least this large get sequential readahead hints
+    size_t drop_cache_min_mb = 0;                  // First reads of files at least this large are evicted from the page cache, 0 never evicts
+    bool prefetch_references = false;              // Prefetch index.html and the files it references on directory requests
+    bool search_index = false;                     // Index all paths in the background and serve GET /__search
+    unsigned int search_threads = 0;               // Directory walker threads for the index, 0 uses all cores
+    size_t content_cache_mb = 0;                   // Memory for file bodies deduplicated by content hash, 0 disables the cache
+    bool cas_route = false;                        // Serve GET /__cas/<sha256> with immutable caching
+    std::string cas_index_file = "tinyfs-cas.idx"; // Sidecar index persisting content hashes across restarts, relative to the storage directory
+    bool hotset = false;                           // Track the most requested paths and warm them up after a restart
+    std::string hotset_file = ".tinyfs-hotset";    // Hot set profile, relative to the storage directory
+    unsigned int hotset_persist_s = 60;            // How often the hot set profile is written
+    size_t warmup_budget_mb = 256;                 // Bytes of hot files read ahead (and cached) on startup
+    std::string handover_socket;                   // Unix socket for handing listeners to a restarted server, disabled while empty
 
     static ServerConfig load_from_env();
 };
 
+/**
+ * Body type for responses that point at an immutable, possibly shared string instead of owning
+ * a copy, so a cached file body goes out to every client without being duplicated per request.
+ * Only serialization is supported.
+ */
+struct SharedBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type &body) { return body ? body->size() : 0; }
+
+    class writer {
+      public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields> &, const value_type &body) : body_(body) {}
+
+        void init(beast::error_code &ec) { ec = {}; }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code &ec) {
+            ec = {};
+            if (done_ || size(body_) == 0) {
+                return boost::none;
+            }
+            done_ = true;
+            return {{const_buffers_type(body_->data(), body_->size()), false}};
+        }
+
+      private:
+        const value_type &body_;
+        bool done_ = false;
+    };
+};
+
+using Response = http::response<SharedBody>;
+
 /**
  * Sets a generic HTTP response with custom status, body, and content type.
  * @param res The HTTP response object to modify
@@ -26,12 +92,19 @@ struct ServerConfig {
  * @param body The response body content
  * @param content_type The content type of the response
  */
-void set_response_generic(http::response<http::string_body> &res, http::status status, const std::string &body, const std::string &content_type);
-void set_response_200(http::response<http::string_body> &res, const std::string &body, const std::string &mime_type);
-void set_response_403(http::response<http::string_body> &res);
-void set_response_404(http::response<http::string_body> &res);
-void set_response_405(http::response<http::string_body> &res);
-void set_response_500(http::response<http::string_body> &res);
+void set_response_generic(Response &res, http::status status, std::string body, const std::string &content_type);
+void set_response_200(Response &res, std::string body, const std::string &mime_type);
+void set_response_200(Response &res, std::shared_ptr<const std::string> body, const std::string &mime_type);
+void set_response_403(Response &res);
+void set_response_404(Response &res);
+void set_response_405(Response &res);
+void set_response_429(Response &res);
+void set_response_500(Response &res);
+
+/**
+ * Appends `s` as a quoted JSON string, escaping quotes, backslashes and control characters.
+ */
+void append_json_string(std::string &out, std::string_view s);
 
 /**
  * Determines the MIME type based on file extension.
@@ -41,7 +114,23 @@ void set_response_500(http::response<http::string_body> &res);
 std::string get_mime_type(const std::string &path);
 
 /**
- * Reads the entire contents of a file into a string.
+ * Kernel access hints applied while reading a file.
+ */
+struct ReadHints {
+    size_t readahead_min_bytes = 256 * 1024;        // Advise sequential access and start readahead from this size
+    size_t drop_cache_min_bytes = 0;                // Drop the file from the page cache after reading from this size, 0 never drops
+    bool drop_first_read_only = false;              // Only drop paths that were not read before, repeat reads stay cached
+};
+
+/**
+ * Marks a path as read before, so read_file() keeps it in the page cache from now on.
+ * Used for paths that are known to be hot before their first request.
+ */
+void mark_read_before(const std::string &file_path);
+
+/**
+ * Reads the entire contents of a file into a string. Only the first read of a large path
+ * drops it from the page cache, so files that are requested again stay cached.
  * @param file_path Path to the file to read
  * @param config Server configuration containing max file size limit
  * @return File contents as string, empty on error
@@ -50,11 +139,14 @@ std::string read_file(const std::string &file_path, const ServerConfig &config);
 
 /**
  * Reads a file with size limit and streaming support.
+ * Large files are read with sequential readahead; huge files can be dropped from the
+ * page cache afterwards so one-off reads don't evict the hot set.
  * @param file_path Path to the file to read
  * @param max_size_mb Maximum file size in MB
+ * @param hints Readahead and cache eviction thresholds
  * @return File contents as string, empty on error or if file too large
  */
-std::string read_file_safe(const std::string &file_path, size_t max_size_mb);
+std::string read_file_safe(const std::string &file_path, size_t max_size_mb, const ReadHints &hints = {});
 
 /**
  * Parses command line arguments to determine the directory to serve files from.
@@ -72,6 +164,7 @@ void mkdir(const fs::path &dir);
 
 /**
  * Initializes the global logger with stdout color sink.
+ * Lines logged while a sampled request is in flight are prefixed with its trace ID.
  */
 void init_logger();
 
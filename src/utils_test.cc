@@ -9,11 +9,11 @@
 
 class ResponseFunctionTest : public ::testing::Test {
   protected:
-    void SetUp() override { response = http::response<http::string_body>{}; }
+    void SetUp() override { response = Response{}; }
 
     void TearDown() override {}
 
-    http::response<http::string_body> response;
+    Response response;
 };
 
 TEST_F(ResponseFunctionTest, SetResponse200) {
@@ -23,7 +23,7 @@ TEST_F(ResponseFunctionTest, SetResponse200) {
     set_response_200(response, body, mime_type);
 
     EXPECT_EQ(response.result(), http::status::ok);
-    EXPECT_EQ(response.body(), body);
+    EXPECT_EQ(*response.body(), body);
     EXPECT_EQ(response[http::field::content_type], mime_type);
     EXPECT_EQ(response[http::field::server], "TinyFS");
 }
@@ -34,7 +34,7 @@ TEST_F(ResponseFunctionTest, SetResponse404) {
     EXPECT_EQ(response.result(), http::status::not_found);
     EXPECT_EQ(response[http::field::content_type], "text/html");
     EXPECT_EQ(response[http::field::server], "TinyFS");
-    EXPECT_TRUE(response.body().find("404 Not Found") != std::string::npos);
+    EXPECT_TRUE(response.body()->find("404 Not Found") != std::string::npos);
 }
 
 TEST_F(ResponseFunctionTest, SetResponse403) {
@@ -43,7 +43,7 @@ TEST_F(ResponseFunctionTest, SetResponse403) {
     EXPECT_EQ(response.result(), http::status::forbidden);
     EXPECT_EQ(response[http::field::content_type], "text/html");
     EXPECT_EQ(response[http::field::server], "TinyFS");
-    EXPECT_TRUE(response.body().find("403 Forbidden") != std::string::npos);
+    EXPECT_TRUE(response.body()->find("403 Forbidden") != std::string::npos);
 }
 
 TEST_F(ResponseFunctionTest, SetResponse405) {
@@ -52,7 +52,7 @@ TEST_F(ResponseFunctionTest, SetResponse405) {
     EXPECT_EQ(response.result(), http::status::method_not_allowed);
     EXPECT_EQ(response[http::field::content_type], "text/html");
     EXPECT_EQ(response[http::field::server], "TinyFS");
-    EXPECT_TRUE(response.body().find("405 Method Not Allowed") != std::string::npos);
+    EXPECT_TRUE(response.body()->find("405 Method Not Allowed") != std::string::npos);
 }
 
 TEST_F(ResponseFunctionTest, SetResponse500) {
@@ -61,7 +61,7 @@ TEST_F(ResponseFunctionTest, SetResponse500) {
     EXPECT_EQ(response.result(), http::status::internal_server_error);
     EXPECT_EQ(response[http::field::content_type], "text/html");
     EXPECT_EQ(response[http::field::server], "TinyFS");
-    EXPECT_TRUE(response.body().find("500 Internal Server Error") != std::string::npos);
+    EXPECT_TRUE(response.body()->find("500 Internal Server Error") != std::string::npos);
 }
 
 TEST_F(ResponseFunctionTest, SetResponseGeneric) {
@@ -71,7 +71,7 @@ TEST_F(ResponseFunctionTest, SetResponseGeneric) {
     set_response_generic(response, http::status::created, body, content_type);
 
     EXPECT_EQ(response.result(), http::status::created);
-    EXPECT_EQ(response.body(), body);
+    EXPECT_EQ(*response.body(), body);
     EXPECT_EQ(response[http::field::content_type], content_type);
     EXPECT_EQ(response[http::field::server], "TinyFS");
 }
@@ -82,7 +82,7 @@ TEST_F(ResponseFunctionTest, SetResponseDefaultContentType) {
     set_response_generic(response, http::status::accepted, body, "text/html");
 
     EXPECT_EQ(response.result(), http::status::accepted);
-    EXPECT_EQ(response.body(), body);
+    EXPECT_EQ(*response.body(), body);
     EXPECT_EQ(response[http::field::content_type], "text/html");
     EXPECT_EQ(response[http::field::server], "TinyFS");
 }
@@ -244,6 +244,46 @@ TEST_F(ReadFileTest, FileWithSpecialCharacters) {
     std::remove(temp_file.c_str());
 }
 
+TEST_F(ReadFileTest, LargeFileWithAccessHints) {
+    const std::string temp_file = "/tmp/hinted_file_test.bin";
+    std::string test_content(3 * 1024 * 1024, '\0');
+    for (size_t i = 0; i < test_content.size(); ++i) {
+        test_content[i] = static_cast<char>(i * 31);
+    }
+
+    std::ofstream out(temp_file, std::ios::binary);
+    out << test_content;
+    out.close();
+
+    // readahead and page cache eviction both kick in, the contents must be unaffected
+    ReadHints hints;
+    hints.readahead_min_bytes = 1024;
+    hints.drop_cache_min_bytes = 1024 * 1024;
+    EXPECT_EQ(read_file_safe(temp_file, 100, hints), test_content);
+
+    // the first read drops the file from the page cache, the repeat read keeps it
+    config.readahead_min_kb = 1;
+    config.drop_cache_min_mb = 1;
+    EXPECT_EQ(read_file(temp_file, config), test_content);
+    EXPECT_EQ(read_file(temp_file, config), test_content);
+
+    std::remove(temp_file.c_str());
+}
+
+TEST_F(ReadFileTest, FileAboveSizeLimit) {
+    const std::string temp_file = "/tmp/too_large_file_test.txt";
+
+    std::ofstream out(temp_file);
+    out << "not empty";
+    out.close();
+
+    EXPECT_TRUE(read_file_safe(temp_file, 0).empty());
+
+    std::remove(temp_file.c_str());
+}
+
+TEST_F(ReadFileTest, DirectoryIsNotReadable) { EXPECT_TRUE(read_file_safe("/tmp", 100).empty()); }
+
 class ParseCmdTest : public ::testing::Test {
   protected:
     void SetUp() override {}